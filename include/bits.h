@@ -0,0 +1,224 @@
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Largest grid of the build : 64, or 128 and 256 for the stress workloads
+ * (`make MAX_SIZE=256`). Every line of a build takes as many words as its
+ * largest one, small grids are faster in the default build. */
+#ifndef MAX_GRID_SIZE
+#define MAX_GRID_SIZE 64
+#endif
+
+#if MAX_GRID_SIZE != 64 && MAX_GRID_SIZE != 128 && MAX_GRID_SIZE != 256
+#error "MAX_GRID_SIZE must be 64, 128 or 256"
+#endif
+
+/* 64-bit words of a line. */
+#define LINE_WORDS (MAX_GRID_SIZE / 64)
+
+/* One bit per cell of a line (or per line of an axis) : bit j is bit j % 64
+ * of word j / 64. The operations go through every word, the shifts carry
+ * the bits across them, so the loops vanish in the default build. */
+typedef struct
+{
+  uint64_t w[LINE_WORDS];
+} t_bits;
+
+/* Index of the lowest activated bit of a non-zero binary int. */
+#if defined(__GNUC__) && !defined(PORTABLE_POPCOUNT)
+#define lowest_bit(x) (__builtin_ctzll(x))
+#else
+static inline int lowest_bit(uint64_t x)
+{
+  int i = 0;
+  while (((x >> i) & 1) == 0)
+    i++;
+  return i;
+}
+#endif
+
+/* Counts the bits activated to 1 in a word. */
+static inline int word_count(uint64_t word)
+{
+#if defined(__GNUC__) && !defined(PORTABLE_POPCOUNT)
+  /* A single POPCNT instruction when the build enables it (POPCNT in
+   * src/Makefile), a few shifts and masks from libgcc otherwise. */
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  while (word)
+  {
+    word &= (word - 1); /* Remove the last non-zero bit */
+    count++;
+  }
+
+  return count;
+#endif
+}
+
+/* Words of a line of at most 64 cells, for the tables of lines.c and the
+ * rows of count.c. */
+
+/* Only bit i of a word. */
+#define word_singleton(i) ((uint64_t)1 << (i))
+
+/* The `size` lowest bits of a word, for 0 < size <= 64. */
+#define word_full(size) (UINT64_MAX >> (64 - (size)))
+
+/* Bit j of the word x, 0 or 1. */
+#define word_bit(x, j) (((x) >> (j)) & 1)
+
+static inline t_bits bits_zero(void)
+{
+  t_bits r = {{0}};
+  return r;
+}
+
+/* Only bit i. */
+static inline t_bits bits_singleton(int i)
+{
+  t_bits r = {{0}};
+  r.w[i / 64] = (uint64_t)1 << (i % 64);
+  return r;
+}
+
+/* The n lowest bits, for 0 <= n <= MAX_GRID_SIZE. */
+static inline t_bits bits_full(int n)
+{
+  t_bits r;
+  for (int w = 0; w < LINE_WORDS; w++)
+  {
+    int bits = n - 64 * w;
+    r.w[w] = (bits >= 64) ? UINT64_MAX
+             : (bits <= 0) ? 0
+                           : (UINT64_MAX >> (64 - bits));
+  }
+  return r;
+}
+
+static inline bool bits_test(t_bits a, int i)
+{
+  return (a.w[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void bits_set(t_bits *a, int i)
+{
+  a->w[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+static inline void bits_reset(t_bits *a, int i)
+{
+  a->w[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+
+static inline t_bits bits_and(t_bits a, t_bits b)
+{
+  for (int w = 0; w < LINE_WORDS; w++)
+    a.w[w] &= b.w[w];
+  return a;
+}
+
+static inline t_bits bits_or(t_bits a, t_bits b)
+{
+  for (int w = 0; w < LINE_WORDS; w++)
+    a.w[w] |= b.w[w];
+  return a;
+}
+
+static inline t_bits bits_xor(t_bits a, t_bits b)
+{
+  for (int w = 0; w < LINE_WORDS; w++)
+    a.w[w] ^= b.w[w];
+  return a;
+}
+
+/* a & ~b. */
+static inline t_bits bits_andnot(t_bits a, t_bits b)
+{
+  for (int w = 0; w < LINE_WORDS; w++)
+    a.w[w] &= ~b.w[w];
+  return a;
+}
+
+/* a >> n for 0 < n < 64 : each word takes the low bits of the next one. */
+static inline t_bits bits_shr(t_bits a, int n)
+{
+  t_bits r;
+  for (int w = 0; w < LINE_WORDS; w++)
+  {
+    r.w[w] = a.w[w] >> n;
+    if (w + 1 < LINE_WORDS)
+      r.w[w] |= a.w[w + 1] << (64 - n);
+  }
+  return r;
+}
+
+/* a << n for 0 < n < 64 : each word takes the high bits of the previous
+ * one, the bits shifted out of the last word are lost. */
+static inline t_bits bits_shl(t_bits a, int n)
+{
+  t_bits r;
+  for (int w = 0; w < LINE_WORDS; w++)
+  {
+    r.w[w] = a.w[w] << n;
+    if (w > 0)
+      r.w[w] |= a.w[w - 1] >> (64 - n);
+  }
+  return r;
+}
+
+static inline bool bits_any(t_bits a)
+{
+  uint64_t any = 0;
+  for (int w = 0; w < LINE_WORDS; w++)
+    any |= a.w[w];
+  return any != 0;
+}
+
+static inline bool bits_equal(t_bits a, t_bits b)
+{
+  return !bits_any(bits_xor(a, b));
+}
+
+static inline int bits_count(t_bits a)
+{
+  int count = 0;
+  for (int w = 0; w < LINE_WORDS; w++)
+    count += word_count(a.w[w]);
+  return count;
+}
+
+/* Index of the lowest activated bit of non-zero bits. */
+static inline int bits_lowest(t_bits a)
+{
+  int w = 0;
+  while (a.w[w] == 0)
+    w++;
+  return 64 * w + lowest_bit(a.w[w]);
+}
+
+/* Removes the lowest activated bit of non-zero bits and returns its
+ * index. */
+static inline int bits_pop(t_bits *a)
+{
+  int w = 0;
+  while (a->w[w] == 0)
+    w++;
+  int i = lowest_bit(a->w[w]);
+  a->w[w] &= a->w[w] - 1;
+  return 64 * w + i;
+}
+
+/* Hash of the two planes of a line. */
+static inline uint64_t bits_hash(const t_bits line[2])
+{
+  uint64_t hash = 0;
+  for (int w = 0; w < LINE_WORDS; w++)
+    hash = (hash * 0xFF51AFD7ED558CCD) ^ (line[0].w[w] * 0x9E3779B97F4A7C15) ^
+           (line[1].w[w] * 0xC2B2AE3D27D4EB4F);
+  return hash;
+}
+
+#endif /* BITS_H */
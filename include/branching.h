@@ -0,0 +1,30 @@
+#ifndef BRANCHING_H
+#define BRANCHING_H
+
+#include <stdbool.h>
+
+#include <grid.h>
+
+/* Strategies picking the next cell of the search and the value tried
+ * first. */
+typedef enum
+{
+  BRANCH_FILLED,      /* grid_choice : most filled line, alternate values. */
+  BRANCH_BALANCE,     /* Same cell, value most needed by its line and column. */
+  BRANCH_CONSTRAINED, /* Cell of the line with the fewest legal completions. */
+  BRANCH_LOOKAHEAD,   /* Cell whose two values force the most cells. */
+  BRANCH_COUNT
+} branching_t;
+
+/* Names of the strategies on the command line, indexed by branching_t. */
+extern const char *branching_names[BRANCH_COUNT];
+
+/* Returns the strategy called `name`, or BRANCH_COUNT if there is none. */
+branching_t branching_from_name(const char *name);
+
+/* Returns the next choice on `grid`, which must be consistent and not
+ * full. BRANCH_LOOKAHEAD tries the choices on `scratch`, a grid of the same
+ * size, the other strategies don't use it. */
+choice_t branching_choice(t_grid *grid, branching_t strategy, t_grid *scratch);
+
+#endif /* BRANCHING_H */
@@ -0,0 +1,33 @@
+#ifndef CDCL_H
+#define CDCL_H
+
+#include <stdbool.h>
+
+#include <grid.h>
+#include <solver.h>
+
+/* Clauses learned between two reductions of the clause database. */
+#define CDCL_FIRST_REDUCE 2000
+#define CDCL_REDUCE_INCREMENT 300
+
+/* Conflicts of the first run between restarts, scaled by the Luby
+ * sequence. */
+#define CDCL_RESTART_BASE 100
+
+/* Solves `grid` with conflict-driven clause learning instead of the trail
+ * search : one boolean per cell (true for ONE), clauses for the three in a
+ * row rule, native propagators for the balance of the lines and for the
+ * distinct lines. Conflicts are analysed down to the first unique
+ * implication point, the search backjumps, keeps the learned clause and
+ * restarts following the Luby sequence.
+ *
+ * Uses the mode, output, budget and counters of `solver` like trail_solver
+ * and prints the same output, MODE_ALL blocks each solution found to look
+ * for the next one : every blocking clause stays in the database, counting
+ * many solutions is faster with the trail engine. `stats.nodes` counts decisions and `stats.backtracks`
+ * conflicts. With MODE_FIRST `grid` holds the solution when true is
+ * returned. Each decision gives its variable the value it had last, or
+ * its value in `solver->hint` at first. */
+bool cdcl_solver(t_solver *solver, t_grid *grid);
+
+#endif /* CDCL_H */
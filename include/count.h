@@ -0,0 +1,30 @@
+#ifndef COUNT_H
+#define COUNT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <grid.h>
+#include <solver.h>
+
+/* Rows are completed as single words : larger grids are counted by the
+ * search. */
+#define COUNT_MAX_SIZE 64
+
+/* Slots of the table of memoized counts, a power of 2 : 48 MB. */
+#define COUNT_MEMO_SIZE (1 << 21)
+
+/* Counts the solutions of `grid`, of at most COUNT_MAX_SIZE, without
+ * building nor printing them : the
+ * rows are completed from top to bottom and the number of completions of
+ * the rows left is memoized on a canonical key of the residual state. Rows
+ * above the last two only matter through the number of ones of each
+ * column, the set of rows already used and the partition of the columns
+ * into equal prefixes, so every order of these rows is counted once.
+ *
+ * Adds the count to `stats->solutions`, the rows tried to `stats->nodes`
+ * and the counts found in the table to `stats->memo_hits`. Counts above
+ * UINT64_MAX wrap around. */
+uint64_t count_solutions(t_grid *grid, t_stats *stats);
+
+#endif /* COUNT_H */
@@ -0,0 +1,137 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <grid.h>
+#include <solver.h>
+
+/* Ratio of the cells kept as clues. */
+#define N 0.3
+#define MAX_ASSEMBLE_LOOP 10
+
+/* The generator seeds 1/GEN_SEED_RATIO of the grid at random, then the
+ * solver gets GEN_MAX_NODES nodes per 64x64 cells to complete it before a
+ * restart. */
+#define GEN_SEED_RATIO 4
+#define GEN_MAX_NODES 2000
+
+/* Nodes to refute the flip of a cell before keeping it as a clue. */
+#define GEN_REFUTE_NODES 200
+
+/* Full grids tried before giving up on a difficulty. */
+#define GEN_DIFFICULTY_TRIES 50
+
+/* Clues each thread checks in a batch of the minimization. */
+#define GEN_MINIMIZE_BATCH 2
+
+/* Decisions of the CDCL engine to check a clue the trail search couldn't,
+ * an undecided clue is kept. */
+#define GEN_MINIMIZE_NODES 5000
+
+/* Difficulty of a puzzle : the hardest step needed to solve it. */
+typedef enum
+{
+  DIFFICULTY_NONE,   /* No target, the ratio N of clues is kept. */
+  DIFFICULTY_EASY,   /* Consecutive and inbetween cells. */
+  DIFFICULTY_MEDIUM, /* Half filled lines. */
+  DIFFICULTY_HARD,   /* Elimination of the illegal completions of a line. */
+  DIFFICULTY_EXPERT, /* Search. */
+  DIFFICULTY_COUNT
+} difficulty_t;
+
+/* Names of the difficulties on the command line, indexed by
+ * difficulty_t. */
+extern const char *difficulty_names[DIFFICULTY_COUNT];
+
+/* Returns the difficulty called `name`, or DIFFICULTY_COUNT if there is
+ * none. */
+difficulty_t difficulty_from_name(const char *name);
+
+/* What to generate. */
+typedef struct
+{
+  int size;
+  bool unique;
+  difficulty_t difficulty;
+  bool minimize; /* Minimization pass after the removal of cells. */
+  int threads;   /* Threads of the minimization of a single puzzle. */
+  uint64_t seed; /* Master seed of the streams of the puzzles. */
+} t_gen_config;
+
+/* Work of the minimization of a puzzle. */
+typedef struct
+{
+  int removed;   /* Clues removed. */
+  int undecided; /* Clues kept because their check ran out of budget. */
+  double time; /* Seconds spent. */
+} t_gen_stats;
+
+/* Random stream of one puzzle (splitmix64) : no hidden state, so each
+ * worker draws from its own. */
+typedef struct
+{
+  uint64_t state;
+} t_rng;
+
+/* Starts stream number `stream` of the master seed `seed`. */
+void rng_seed(t_rng *rng, uint64_t seed, uint64_t stream);
+
+/* Returns the next 64 random bits of `rng`. */
+uint64_t rng_next(t_rng *rng);
+
+/* Returns a random integer in [0, bound). */
+int rng_below(t_rng *rng, int bound);
+
+/* Returns a master seed which changes from a run to the next, even within
+ * the same second. */
+uint64_t rng_entropy(void);
+
+/* Rates `puzzle`, which has a unique solution, with the rules of the
+ * heuristics (see grid_hardest_rule) : no search, the propagation runs
+ * in `work`, a grid of the same size. */
+difficulty_t puzzle_difficulty(const t_grid *puzzle, t_grid *work);
+
+/* Builds a full valid grid of `size`, drawing from `rng`. */
+t_grid *grid_generate(int size, t_rng *rng);
+
+/* Empties cells of `grid` until the ratio N of clues is left, keeping
+ * its solution unique if `unique`. Returns false if every cell was tried
+ * before the ratio was reached. */
+bool grid_remove_cells(t_grid *grid, bool unique, t_rng *rng);
+
+/* Empties cells of the full `grid` as long as the puzzle keeps a unique
+ * solution no harder than `target`, until every cell has been tried.
+ * Returns true if the puzzle left is exactly as hard as `target`. */
+bool grid_remove_to_difficulty(t_grid *grid, difficulty_t target,
+                               t_rng *rng);
+
+/* Removes the clues `puzzle`, which has a unique solution, can do
+ * without, until each clue left is needed : the puzzle becomes locally
+ * minimal, unless some checks run out of budget. The clues are tried in a
+ * random order, by batches of GEN_MINIMIZE_BATCH per thread checked in
+ * parallel. The work done is written in `stats`. */
+void puzzle_minimize(t_grid *puzzle, int threads, t_rng *rng,
+                     t_gen_stats *stats);
+
+/* Generates the puzzle of `config` from stream `stream` of its seed : the
+ * same seed and stream always give the same puzzle. Without a difficulty,
+ * grids of MIN_GRID_SIZE are full, as with a single generation. Returns
+ * NULL if GEN_DIFFICULTY_TRIES grids didn't give the difficulty. The work
+ * of the minimization is written in `stats`. */
+t_grid *puzzle_generate(const t_gen_config *config, uint64_t stream,
+                        t_gen_stats *stats);
+
+/* Generates `count` puzzles of `config` with `threads` workers, puzzle k
+ * from stream k of the seed, each minimized by its worker alone. Each
+ * puzzle is printed in `fd` as soon as it is finished, preceded by a
+ * comment with its number (a puzzle of the difficulty which can't be
+ * found is only a comment), so the order of the puzzles varies but not
+ * their content. Returns false if the workers can't start. */
+bool generate_batch(const t_gen_config *config, size_t count, int threads,
+                    FILE *fd);
+
+#endif /* GENERATOR_H */
@@ -11,28 +11,73 @@
 #include <unistd.h>
 #include <inttypes.h>
 
+#include <bits.h>
+
 #define EMPTY_CELL '_'
 #define ONE '1'
 #define ZERO '0'
 #define DEFAULT_SIZE 8
 #define MIN_GRID_SIZE 4
-#define MAX_GRID_SIZE 64
 
-typedef uint64_t binline[2];
+/* Zeros then ones of a line. */
+typedef t_bits binline[2];
+
+typedef enum
+{
+  LINE,
+  COLUMN
+} axis_mode;
+
+#define LINESET_CAPACITY (2 * MAX_GRID_SIZE)
+/* log2(LINESET_CAPACITY), the bits of a hash giving the home slot. */
+#define LINESET_BITS (MAX_GRID_SIZE == 256 ? 9 : MAX_GRID_SIZE == 128 ? 8 : 7)
 
+/* Open-addressing hash set of the full lines of one axis, keyed on their
+ * binline. An entry whose line has changed since its insertion (after a
+ * backtrack) is stale : lookups skip it and it is replaced the next time
+ * its line is full. */
 typedef struct
 {
+  binline keys[LINESET_CAPACITY];
+  int16_t index[LINESET_CAPACITY]; /* Line of the entry, -1 if empty. */
+  int16_t slot[MAX_GRID_SIZE];     /* Slot of each line's entry, -1 if none. */
+} t_lineset;
+
+/* Bytes of a cache line. */
+#define GRID_ALIGNMENT 64
+
+/* A grid is a single block with room for the largest size : it lives on
+ * the stack or in an array as well as on the heap, and a copy is one
+ * memcpy. Heap grids and structures holding grids need an allocation
+ * aligned on GRID_ALIGNMENT (see grid_new). */
+typedef struct
+{
+  _Alignas(GRID_ALIGNMENT) binline lines[MAX_GRID_SIZE];
+  _Alignas(GRID_ALIGNMENT) binline columns[MAX_GRID_SIZE];
+  /* Zeros and ones of each line and column, kept up to date by every write
+   * of the grid so that no rule has to count them. */
+  uint16_t counts[2][MAX_GRID_SIZE][2];
+  t_bits dirty[2]; /* Lines and columns changed since the last check. */
+  t_bits queue[2]; /* Lines and columns to give to the heuristics. */
+  t_lineset completed[2]; /* Full lines and full columns. */
   int size;
-  binline *lines;
-  binline *columns;
-  int onHeap;
 } t_grid;
 
+/* Rules of the heuristics, to count their work. */
 typedef enum
 {
-  LINE,
-  COLUMN
-} axis_mode;
+  RULE_CONSECUTIVE,
+  RULE_INBETWEEN,
+  RULE_HALF_LINE,
+  RULE_WHOLE_LINE, /* line_table_heuristic or line_dp_heuristic. */
+  RULE_COUNT
+} rule_id;
+
+typedef struct
+{
+  size_t visits[RULE_COUNT]; /* Lines given to the rule. */
+  size_t forced[RULE_COUNT]; /* Cells filled by the rule. */
+} t_rule_stats;
 
 typedef struct 
 {
@@ -45,20 +90,29 @@ typedef struct
 /* Checks if a character is a significant one. */
 bool check_char(const t_grid *g, const char c);
 
-/* Checks if the size of the grid is a correct one. */
+/* Checks if the size of the grid is a correct one : a power of 2 from
+ * MIN_GRID_SIZE to MAX_GRID_SIZE. */
 bool check_size(const int size);
 
-/* Creates a grid of size size full of empty lines. */
-void grid_allocate(t_grid *grid, int size);
+/* Makes `grid` a grid of size size full of empty lines. */
+void grid_init(t_grid *grid, int size);
 
-/* Frees the allocated bytes of the given grid and all its lines. */
-void grid_free(t_grid *grid);
+/* Returns a heap grid of size size full of empty lines, to release with
+ * free, or NULL if the allocation failed. */
+t_grid *grid_new(int size);
+
+/* Returns the number of grids made by grid_new so far. */
+size_t grid_allocations(void);
+
+/* Parses the grid written in `filename` into a grid of grid_new, returns
+ * NULL and prints the reason if the file is malformed. */
+t_grid *file_parser(char *filename);
 
 /* Prints the grid in the output file given. */
 void grid_print(t_grid *grid, FILE *fd);
 
 /* Copy the content of a grid into another one. */
-void grid_copy(t_grid *gs, t_grid *gd);
+void grid_copy(const t_grid *gs, t_grid *gd);
 
 /* Changes the value of the cell (i,j) in the grid. */
 void set_cell(int i, int j, t_grid *grid, char v);
@@ -66,8 +120,14 @@ void set_cell(int i, int j, t_grid *grid, char v);
 /* Returns the value of the cel (i,j) in the grid. */
 char get_cell(int i, int j, t_grid *grid);
 
-/* Counts the bits activated to 1 in a binary int. */
-int gridline_count(uint64_t gridline);
+/* Counts the bits activated to 1 in a line. */
+int gridline_count(t_bits gridline);
+
+/* Regenerates `dst` as the transpose of `src` (columns from lines or lines
+ * from columns) with a bit-matrix transpose of each plane. Only the sweeps
+ * of grid_heuristics_sweep use it, the queue writes the few cells it
+ * fills in both axes. */
+void grid_transpose(binline *src, binline *dst, int size);
 
 /* Checks if there are any lines or columns in the given grid that are
  * identical, also checks if there are too many zeros or ones  */
@@ -79,6 +139,19 @@ bool no_three_in_a_row(t_grid *grid);
 /* Returns true if the grid respects the takuzu rules. */
 bool is_consistent(t_grid *grid);
 
+/* Same as is_consistent but only checks the lines and columns changed
+ * since the last check, the other ones were consistent and didn't move. */
+bool is_consistent_incremental(t_grid *grid);
+
+/* Marks every line and column to be checked by the next incremental
+ * check and propagated by the next heuristics, and counts their zeros and
+ * ones again, for grids written without going through set_cell. */
+void grid_mark_dirty(t_grid *grid);
+
+/* Counts the zeros and ones of every line and column again, for grids
+ * whose planes were copied without their counts. */
+void grid_recount(t_grid *grid);
+
 /* Returns true if the grid is fully filled.  */
 bool is_full(t_grid *grid);
 
@@ -91,19 +164,53 @@ bool consecutive_cells_heuristic(t_grid *grid);
 
 /* Checks if there are already half of zeros or one in a row/column 
  * and fills the other empty cells with the opposite in that row/column. */
-bool half_line_filled(t_grid *grid, int i, int halfsize);
-
-/* Applies half_line_filled on every column/grid. */
 bool half_line_heuristic(t_grid *grid);
 
 /* Checks if a cell is surrounded by 2 of the same char and fills
  * it to the opposite one. */
 bool inbetween_cells_heuristic(t_grid *grid);
 
-/* Calls all our heuristics on the grid and stops when no changes are
- * made anymore. */
+/* Fills the cells which have the same value in every legal completion of
+ * their line or column (see line_forced). */
+bool line_table_heuristic(t_grid *grid);
+
+/* Same as line_table_heuristic for the sizes above 16, which have too many
+ * legal lines for a table : does nothing on the smaller grids. */
+bool line_dp_heuristic(t_grid *grid);
+
+/* Propagates the cells set since the last call : the rules only run on the
+ * queued lines and columns, a cell filled by a rule queues its crossing
+ * line, until the queue is empty. Returns false if the grid is
+ * inconsistent. The propagation is compiled once for each size, this one
+ * picks it from the size of `grid`. */
 bool grid_heuristics(t_grid *grid);
 
+/* A propagation of the grid, such as grid_heuristics. */
+typedef bool (*t_heuristics)(t_grid *grid);
+
+/* Returns grid_heuristics compiled for grids of `size`, a legal size :
+ * callers propagating many grids of the same size pick it once. */
+t_heuristics grid_heuristics_kernel(int size);
+
+/* Same as grid_heuristics with the rules up to `limit` in the order of
+ * rule_id only. */
+bool grid_heuristics_limited(t_grid *grid, rule_id limit);
+
+/* Propagates `grid` with the consecutive and inbetween rules, and brings
+ * in the next rule only when the ones before are stuck. Returns the last
+ * rule needed to fill the grid, or RULE_COUNT if all of them get stuck
+ * (a search is needed) or the grid is inconsistent. */
+rule_id grid_hardest_rule(t_grid *grid);
+
+/* Same fixed point as grid_heuristics, reached by calling every heuristic
+ * on the whole grid until none of them changes anything. Slower, kept to
+ * measure the queue. */
+bool grid_heuristics_sweep(t_grid *grid);
+
+/* Copies the counters of the rules run by the calling thread since it
+ * started. */
+void rule_stats_get(t_rule_stats *stats);
+
 /* Sets choice cell in the grid to choice.choice. */
 void grid_choice_apply(t_grid *grid, const choice_t choice);
 
@@ -117,8 +224,4 @@ void grid_choice_print(const choice_t choice, FILE *fd);
  * in the grid and character of the choice. */
 choice_t grid_choice(t_grid *grid);
 
-/* Generates a grid with its two outer filters filled following
- * restrictive rules. */
-void grid_outer_ring(t_grid *grid);
-
 #endif /* GRID_H */
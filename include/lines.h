@@ -0,0 +1,35 @@
+#ifndef LINES_H
+#define LINES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <grid.h>
+
+/* Sizes up to TABLE_MAX_SIZE use the tables of all legal lines. */
+#define TABLE_MAX_SIZE 16
+
+/* Entries of the per-thread cache of forced cells. */
+#define LINE_CACHE_SIZE 4096
+
+/* Computes the cells of `line` which have the same value in every legal
+ * completion of the line (balanced, no three in a row) :
+ * forced[0] gets the cells which are 0 in all of them, forced[1] the cells
+ * which are 1. A line without any completion gets every cell in both.
+ * Only for the sizes with a table, the other sizes get nothing. */
+void line_forced(const t_bits *line, int size, t_bits forced[2]);
+
+/* Same result as line_forced for every size, computed by a DP over the
+ * states (position, ones count, trailing run) in linear time. */
+void line_dp_forced(const t_bits *line, int size, t_bits forced[2]);
+
+/* Returns the number of legal completions of `line`, 0 if it has none
+ * and 1 if it is already a legal full line. Saturates at UINT64_MAX, which
+ * only lines above 64 cells reach. */
+uint64_t line_completions(const t_bits *line, int size);
+
+/* Returns the number of legal full lines of a size with a table, 0 for the
+ * other sizes. */
+int line_table_count(int size);
+
+#endif /* LINES_H */
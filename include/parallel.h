@@ -0,0 +1,53 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include <pthread.h>
+
+#include <grid.h>
+#include <solver.h>
+
+#define DEQUE_CAPACITY 64
+
+/* Tasks of a worker : a task is the snapshot (lines then columns) of a grid
+ * which still has to be explored. The tasks from `head` to `tail` fill a
+ * ring of DEQUE_CAPACITY slots. */
+typedef struct
+{
+  binline *tasks;
+  int head; /* Thieves steal the oldest task (the biggest subtree) here. */
+  int tail; /* The owner pushes and pops its newest tasks here. */
+  pthread_mutex_t lock;
+} t_deque;
+
+typedef struct s_pool
+{
+  int size;
+  int threads;
+  t_deque *deques;
+  pthread_mutex_t lock;
+  pthread_cond_t wakeup;
+  atomic_int pending;   /* Tasks pushed and not fully explored yet. */
+  atomic_int available; /* Tasks waiting in the deques. */
+} t_pool;
+
+/* Returns the number of cores of the machine. */
+int parallel_threads(void);
+
+/* Returns true if some workers may be waiting for a task. */
+bool pool_hungry(t_pool *pool);
+
+/* Pushes the state of `grid` as a new task in the deque of `worker`.
+ * Returns false if the deque is full : the caller explores it itself. */
+bool pool_share(t_pool *pool, int worker, t_grid *grid);
+
+/* Counts all the solutions of `grid` with `threads` workers stealing
+ * subtrees from each other, branching with `branching` and probing if
+ * `probing`. Solutions aren't printed, the counters of all workers are
+ * summed in `stats`. */
+bool parallel_count(t_grid *grid, int threads, branching_t branching,
+                    bool probing, t_stats *stats);
+
+#endif /* PARALLEL_H */
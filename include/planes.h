@@ -0,0 +1,78 @@
+#ifndef PLANES_H
+#define PLANES_H
+
+#include <stdbool.h>
+
+#include <bits.h>
+#include <grid.h>
+
+/* The two layouts of a line, side by side. The grid stores the zeros plane
+ * and the ones plane (binline). The known/value layout stores the filled
+ * cells and, among them, the ones : a full line or the empty cells are a
+ * single plane, the zeros need a second one. `bench layout` runs the
+ * kernels of the solver on both. */
+
+/* Filled cells then ones of a line. */
+typedef struct
+{
+  t_bits known;
+  t_bits value;
+} t_kvline;
+
+static inline t_kvline kvline_from_binline(const binline line)
+{
+  t_kvline kv = {bits_or(line[0], line[1]), line[1]};
+  return kv;
+}
+
+/* ------------------------ zeros/ones ------------------------ */
+
+static inline bool binline_is_full(const binline line, t_bits full_line)
+{
+  return bits_equal(bits_xor(line[1], line[0]), full_line);
+}
+
+static inline t_bits binline_empty(const binline line, t_bits full_line)
+{
+  return bits_andnot(full_line, bits_or(line[0], line[1]));
+}
+
+static inline bool binline_identical(const binline a, const binline b)
+{
+  return bits_equal(a[1], b[1]) && bits_equal(a[0], b[0]);
+}
+
+/* Returns true if the line has more than `size / 2` zeros or ones. */
+static inline bool binline_too_many(const binline line, int size)
+{
+  return bits_count(line[0]) > size / 2 || bits_count(line[1]) > size / 2;
+}
+
+/* ------------------------ known/value ------------------------ */
+
+static inline bool kvline_is_full(t_kvline line, t_bits full_line)
+{
+  return bits_equal(line.known, full_line);
+}
+
+static inline t_bits kvline_empty(t_kvline line, t_bits full_line)
+{
+  return bits_andnot(full_line, line.known);
+}
+
+/* Two full lines are identical if they have the same ones : a single
+ * plane. */
+static inline bool kvline_identical_full(t_kvline a, t_kvline b)
+{
+  return bits_equal(a.value, b.value);
+}
+
+/* Same as binline_too_many, the zeros are the filled cells without the
+ * ones. */
+static inline bool kvline_too_many(t_kvline line, int size)
+{
+  int ones = bits_count(line.value);
+  return bits_count(line.known) - ones > size / 2 || ones > size / 2;
+}
+
+#endif /* PLANES_H */
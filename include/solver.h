@@ -0,0 +1,104 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <branching.h>
+#include <grid.h>
+
+typedef enum
+{
+  MODE_FIRST,
+  MODE_ALL
+} mode_t;
+
+/* Outcome of refute_cell. */
+typedef enum
+{
+  REFUTE_REFUTED, /* No solution has the other value. */
+  REFUTE_SOLVED,  /* A solution has it, it is left in the work grid. */
+  REFUTE_BUDGET   /* The search gave up after `max_nodes` nodes. */
+} refute_t;
+
+/* Counters of one search. They live in the solver instead of in
+ * process-global variables. */
+typedef struct
+{
+  size_t solutions;
+  size_t backtracks;
+  size_t nodes;       /* Grids given to the heuristics. */
+  size_t allocations; /* Heap allocations made during the search. */
+  t_rule_stats rules; /* Work of the heuristics during the search. */
+  size_t probes;      /* Cells set and propagated by probing. */
+  size_t fixes;       /* Cells fixed because a probe failed. */
+  double probe_time;  /* Seconds spent probing. */
+  size_t memo_hits;   /* Counts found in the table of count_solutions. */
+  bool solved;
+} t_stats;
+
+/* Preallocated stack of bitboard snapshots : a snapshot of `lines` and
+ * `columns`, with their counts, is pushed before each choice and restored
+ * on backtrack, so the search never allocates. */
+typedef struct
+{
+  int size;
+  int depth;
+  int capacity;
+  binline *snapshots;
+  uint16_t (*counts)[2]; /* Counts of the lines then of the columns. */
+} t_trail;
+
+struct s_pool;
+
+typedef struct
+{
+  mode_t mode;
+  FILE *fd;     /* Solutions are printed in `fd`, NULL to print nothing. */
+  bool verbose;
+  t_trail trail;
+  t_stats stats;
+  size_t max_nodes; /* The search gives up after `max_nodes`, 0 = never. */
+  size_t max_solutions; /* MODE_ALL stops at `max_solutions`, 0 = never. */
+  struct s_pool *pool; /* Work-stealing pool of the worker, or NULL. */
+  int worker;
+  t_heuristics heuristics; /* grid_heuristics_kernel by default. */
+  branching_t branching; /* BRANCH_FILLED by default. */
+  bool probing;          /* Failed-literal probing before each choice. */
+  const t_grid *hint; /* Full grid whose values cdcl_solver tries first. */
+  t_grid scratch; /* Grid where probes and BRANCH_LOOKAHEAD try choices. */
+} t_solver;
+
+/* Allocates a trail deep enough to solve `grid` : every choice fills at
+ * least one empty cell, so we never need more snapshots than empty cells. */
+bool trail_allocate(t_trail *trail, t_grid *grid);
+
+/* Frees the snapshots of the trail. */
+void trail_free(t_trail *trail);
+
+/* Initializes the solver and its trail for `grid`. */
+bool solver_init(t_solver *solver, t_grid *grid, FILE *fd, const mode_t mode,
+                 bool verbose);
+
+/* Frees the trail of the solver. */
+void solver_free(t_solver *solver);
+
+/* Same search as grid_solver but in place : `grid` is never copied, the
+ * trail is used to undo choices. With MODE_FIRST `grid` holds the solution
+ * when true is returned. Counters are added to `solver->stats`. */
+bool trail_solver(t_solver *solver, t_grid *grid);
+
+/* Returns true if `grid` has exactly one solution. The search stops at the
+ * second solution and prints nothing, `grid` is left unchanged. */
+bool has_unique_solution(t_grid *grid);
+
+/* `puzzle` has a unique solution where cell (row, column) is `value`.
+ * Looks for a solution with the other value in the cell : emptying it
+ * keeps the solution unique if the flip is refuted. The search runs in
+ * `work`, a grid of the same size, with `solver` in MODE_FIRST initialized
+ * for an empty grid so that both are reused from a call to the next. */
+refute_t refute_cell(t_solver *solver, t_grid *work, const t_grid *puzzle,
+                     int row, int column, char value);
+
+#endif /* SOLVER_H */
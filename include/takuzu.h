@@ -4,23 +4,28 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <err.h>
 #include <getopt.h>
 #include <time.h>
 
+#include <cdcl.h>
+#include <count.h>
+#include <generator.h>
 #include <grid.h>
+#include <parallel.h>
+#include <solver.h>
 
-#define N 0.3
 #define STDOUT stdout
 #define GEN_MODE 0
 #define SOL_MODE 1
-#define MAX_ASSEMBLE_LOOP 10
 
 typedef enum
 {
-  MODE_FIRST,
-  MODE_ALL
-} mode_t;
+  ENGINE_TRAIL,
+  ENGINE_COPY,
+  ENGINE_CDCL
+} engine_t;
 
 #endif /* TAKUZU_H */
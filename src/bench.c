@@ -0,0 +1,609 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <err.h>
+
+#include <cdcl.h>
+#include <generator.h>
+#include <grid.h>
+#include <parallel.h>
+#include <planes.h>
+#include <solver.h>
+
+#define DEFAULT_THREADS_GRID "tests/8x8_inbetween"
+#define NODES_BUDGET 100000
+
+/* Generated 64x64 puzzles of `bench layout`, and passes of each kernel over
+ * the lines of a grid. */
+#define LAYOUT_PUZZLES 3
+#define LAYOUT_SEED 2024
+#define LAYOUT_PASSES 20000
+
+/* One grid of each size, the search is too long to be complete on the
+ * biggest ones : benchmarks give a budget of nodes to the solver. */
+static char *default_grids[] = {"tests/8x8_inbetween", "tests/example_16.txt",
+                                "tests/bench/grid_32.txt",
+                                "tests/bench/grid_64.txt", NULL};
+
+/* The solvable grids of tests/, for the strategies of branching. */
+static char *corpus_grids[] = {"tests/grid_4x4",
+                               "tests/8x8_inbetween",
+                               "tests/correct_grid_8x8",
+                               "tests/grid_8x8_2",
+                               "tests/mdr.txt",
+                               "tests/examples_grid/correct.txt",
+                               "tests/example_grid_correct/heuristic.txt",
+                               "tests/example_grid_correct/nosolution.txt",
+                               "tests/example_grid_correct/onesolution.txt",
+                               "tests/example_grid_correct/severalsolutions.txt",
+                               "tests/example_16.txt",
+                               "tests/bench/grid_32.txt",
+                               "tests/bench/grid_64.txt",
+                               NULL};
+
+/* Wall clock time in seconds, clock() would add the time of all threads. */
+static double now(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_help()
+{
+  printf("Usage: bench [threads [FILE [MAX_THREADS]]]\n"
+         "       bench nodes [FILE...]\n"
+         "       bench propagation [FILE...]\n"
+         "       bench branching [FILE...]\n"
+         "       bench engines [FILE...]\n"
+         "       bench layout [FILE...]\n"
+         "Benchmarks of the takuzu solver, run all of them without argument\n\n"
+         "threads   scaling of the MODE_ALL counting from 1 to MAX_THREADS\n"
+         "          threads (default: %s, number of cores)\n"
+         "nodes     time per node of the search, for %d nodes of MODE_ALL\n"
+         "          (default: one grid of each size in tests/)\n"
+         "propagation\n"
+         "          line visits of each rule with the propagation queue and\n"
+         "          with sweeps of the whole grid, for the same nodes\n"
+         "branching backtracks and time of each branching strategy to find\n"
+         "          the first solution, at most %d nodes (default: the grids\n"
+         "          of tests/)\n"
+         "engines   trail and cdcl engines on the same grids, for the first\n"
+         "          solution, at most %d nodes (default: the grids of tests/)\n"
+         "layout    line kernels on the zeros/ones planes of the grid and on\n"
+         "          known/value planes, for the puzzle, its propagation and\n"
+         "          its solution (default: the grids of tests/ and %d\n"
+         "          generated 64x64 puzzles)\n",
+         DEFAULT_THREADS_GRID, NODES_BUDGET, NODES_BUDGET, NODES_BUDGET,
+         LAYOUT_PUZZLES);
+}
+
+/* Counts the solutions of `filename` with 1 to `max_threads` workers. */
+static void bench_threads(char *filename, int max_threads)
+{
+  t_grid *grid = file_parser(filename);
+  if (grid == NULL)
+    errx(EXIT_FAILURE, "error: error with file %s", filename);
+
+  printf("# threads: counting all solutions of %s\n", filename);
+  printf("%8s %12s %12s %10s %8s\n", "threads", "solutions", "backtracks",
+         "time (s)", "speedup");
+
+  t_grid work;
+  double reference = 0;
+
+  for (int threads = 1; threads <= max_threads; threads++)
+  {
+    grid_copy(grid, &work);
+
+    t_stats stats;
+    double start = now();
+    parallel_count(&work, threads, BRANCH_FILLED, false, &stats);
+    double time = now() - start;
+
+    if (threads == 1)
+      reference = time;
+
+    printf("%8d %12ld %12ld %10.3f %8.2f\n", threads, stats.solutions,
+           stats.backtracks, time, reference / time);
+  }
+  printf("\n");
+
+  free(grid);
+}
+
+/* Explores `NODES_BUDGET` nodes of the search tree of each grid. */
+static void bench_nodes(char **filenames)
+{
+  printf("# nodes: time per node of the search\n");
+  printf("%-26s %6s %10s %10s %10s\n", "grid", "size", "nodes", "time (s)",
+         "ns/node");
+
+  for (int i = 0; filenames[i] != NULL; i++)
+  {
+    t_grid *grid = file_parser(filenames[i]);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: error with file %s", filenames[i]);
+
+    t_solver solver;
+    if (!solver_init(&solver, grid, NULL, MODE_ALL, false))
+      errx(EXIT_FAILURE, "error: can't initialize the solver");
+    solver.max_nodes = NODES_BUDGET;
+
+    double start = now();
+    trail_solver(&solver, grid);
+    double time = now() - start;
+
+    printf("%-26s %6d %10ld %10.3f %10.1f\n", filenames[i], grid->size,
+           solver.stats.nodes, time, time * 1e9 / solver.stats.nodes);
+
+    solver_free(&solver);
+    free(grid);
+  }
+  printf("\n");
+}
+
+static const char *rule_names[RULE_COUNT] = {"consecutive", "inbetween",
+                                             "half line", "whole line"};
+
+/* Explores the same nodes of each grid with both propagators, the rules
+ * reach the same fixed points : only the line visits differ. */
+static void bench_propagation(char **filenames)
+{
+  bool (*propagators[])(t_grid *) = {grid_heuristics, grid_heuristics_sweep};
+  const char *names[] = {"queue", "sweep"};
+
+  printf("# propagation: line visits of the rules, %d nodes of MODE_ALL\n",
+         NODES_BUDGET);
+  printf("%-26s %-6s %10s", "grid", "", "time (s)");
+  for (int r = 0; r < RULE_COUNT; r++)
+    printf(" %12s", rule_names[r]);
+  printf(" %12s\n", "total");
+
+  for (int i = 0; filenames[i] != NULL; i++)
+  {
+    t_grid *grid = file_parser(filenames[i]);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: error with file %s", filenames[i]);
+
+    size_t totals[2] = {0, 0};
+    for (int p = 0; p < 2; p++)
+    {
+      t_grid work;
+      grid_copy(grid, &work);
+
+      t_solver solver;
+      if (!solver_init(&solver, &work, NULL, MODE_ALL, false))
+        errx(EXIT_FAILURE, "error: can't initialize the solver");
+      solver.max_nodes = NODES_BUDGET;
+      solver.heuristics = propagators[p];
+
+      double start = now();
+      trail_solver(&solver, &work);
+      double time = now() - start;
+
+      printf("%-26s %-6s %10.3f", filenames[i], names[p], time);
+      for (int r = 0; r < RULE_COUNT; r++)
+      {
+        printf(" %12ld", solver.stats.rules.visits[r]);
+        totals[p] += solver.stats.rules.visits[r];
+      }
+      printf(" %12ld\n", totals[p]);
+
+      solver_free(&solver);
+    }
+
+    printf("%-26s %-6s %10s visits saved: %.1f%%\n", "", "", "",
+           100.0 * ((double)totals[1] - (double)totals[0]) / totals[1]);
+
+    free(grid);
+  }
+  printf("\n");
+}
+
+/* Searches the first solution of each grid with every strategy. */
+static void bench_branching(char **filenames)
+{
+  size_t backtracks[BRANCH_COUNT] = {0};
+  size_t nodes[BRANCH_COUNT] = {0};
+  double times[BRANCH_COUNT] = {0};
+
+  printf("# branching: first solution, at most %d nodes\n", NODES_BUDGET);
+  printf("%-48s %-12s %10s %10s %10s\n", "grid", "strategy", "nodes",
+         "backtracks", "time (s)");
+
+  for (int i = 0; filenames[i] != NULL; i++)
+  {
+    t_grid *grid = file_parser(filenames[i]);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: error with file %s", filenames[i]);
+
+    for (branching_t b = 0; b < BRANCH_COUNT; b++)
+    {
+      t_grid work;
+      grid_copy(grid, &work);
+
+      t_solver solver;
+      if (!solver_init(&solver, &work, NULL, MODE_FIRST, false))
+        errx(EXIT_FAILURE, "error: can't initialize the solver");
+      solver.max_nodes = NODES_BUDGET;
+      solver.branching = b;
+
+      double start = now();
+      trail_solver(&solver, &work);
+      double time = now() - start;
+
+      printf("%-48s %-12s %10ld %10ld %10.4f\n", filenames[i],
+             branching_names[b], solver.stats.nodes, solver.stats.backtracks,
+             time);
+      nodes[b] += solver.stats.nodes;
+      backtracks[b] += solver.stats.backtracks;
+      times[b] += time;
+
+      solver_free(&solver);
+    }
+
+    free(grid);
+  }
+
+  for (branching_t b = 0; b < BRANCH_COUNT; b++)
+    printf("%-48s %-12s %10ld %10ld %10.4f\n", "total", branching_names[b],
+           nodes[b], backtracks[b], times[b]);
+  printf("\n");
+}
+
+/* A/B comparison of the trail and cdcl engines on the first solution :
+ * nodes are choices and decisions, backtracks are dead ends and
+ * conflicts. */
+static void bench_engines(char **filenames)
+{
+  static const char *engine_names[2] = {"trail", "cdcl"};
+  bool (*engines[2])(t_solver *, t_grid *) = {trail_solver, cdcl_solver};
+  size_t nodes[2] = {0};
+  size_t backtracks[2] = {0};
+  double times[2] = {0};
+
+  printf("# engines: first solution, at most %d nodes\n", NODES_BUDGET);
+  printf("%-48s %-8s %-6s %10s %10s %10s\n", "grid", "engine", "solved",
+         "nodes", "backtracks", "time (s)");
+
+  for (int i = 0; filenames[i] != NULL; i++)
+  {
+    t_grid *grid = file_parser(filenames[i]);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: error with file %s", filenames[i]);
+
+    for (int e = 0; e < 2; e++)
+    {
+      t_grid work;
+      grid_copy(grid, &work);
+
+      t_solver solver;
+      if (!solver_init(&solver, &work, NULL, MODE_FIRST, false))
+        errx(EXIT_FAILURE, "error: can't initialize the solver");
+      solver.max_nodes = NODES_BUDGET;
+
+      double start = now();
+      bool solved = engines[e](&solver, &work);
+      double time = now() - start;
+
+      if (solved && !is_valid(&work))
+        errx(EXIT_FAILURE, "error: %s engine gives a wrong solution of %s",
+             engine_names[e], filenames[i]);
+
+      printf("%-48s %-8s %-6s %10ld %10ld %10.4f\n", filenames[i],
+             engine_names[e], solved ? "yes" : "no", solver.stats.nodes,
+             solver.stats.backtracks, time);
+      nodes[e] += solver.stats.nodes;
+      backtracks[e] += solver.stats.backtracks;
+      times[e] += time;
+
+      solver_free(&solver);
+    }
+
+    free(grid);
+  }
+
+  for (int e = 0; e < 2; e++)
+    printf("%-48s %-8s %-6s %10ld %10ld %10.4f\n", "total", engine_names[e],
+           "", nodes[e], backtracks[e], times[e]);
+  printf("\n");
+}
+
+/* Lines and columns of the states of a grid in both layouts. */
+typedef struct
+{
+  binline zo[3 * 2 * MAX_GRID_SIZE];
+  t_kvline kv[3 * 2 * MAX_GRID_SIZE];
+  int count; /* Lines of each layout. */
+  int size;
+} t_layout_lines;
+
+/* A kernel runs over every line of `lines` in one of the layouts and
+ * returns a checksum, which must be the same for both. */
+typedef size_t (*layout_kernel)(const t_layout_lines *lines);
+
+/* Full lines, as in is_full and the consistency checks. */
+static size_t zo_full(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t full = 0;
+  for (int k = 0; k < lines->count; k++)
+    full += binline_is_full(lines->zo[k], full_line);
+  return full;
+}
+
+static size_t kv_full(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t full = 0;
+  for (int k = 0; k < lines->count; k++)
+    full += kvline_is_full(lines->kv[k], full_line);
+  return full;
+}
+
+/* First empty cell of each line which has one, as in grid_choice. */
+static size_t zo_empty(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t sum = 0;
+  for (int k = 0; k < lines->count; k++)
+  {
+    t_bits empty = binline_empty(lines->zo[k], full_line);
+    if (bits_any(empty))
+      sum += bits_lowest(empty);
+  }
+  return sum;
+}
+
+static size_t kv_empty(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t sum = 0;
+  for (int k = 0; k < lines->count; k++)
+  {
+    t_bits empty = kvline_empty(lines->kv[k], full_line);
+    if (bits_any(empty))
+      sum += bits_lowest(empty);
+  }
+  return sum;
+}
+
+/* Pairs of identical full lines among the lines of each state, as in the
+ * duplicate check. */
+static size_t zo_identical(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t pairs = 0;
+  for (int first = 0; first < lines->count; first += lines->size)
+    for (int k = first; k < first + lines->size; k++)
+    {
+      if (!binline_is_full(lines->zo[k], full_line))
+        continue;
+      for (int l = first; l < k; l++)
+        pairs += binline_is_full(lines->zo[l], full_line) &&
+                 binline_identical(lines->zo[k], lines->zo[l]);
+    }
+  return pairs;
+}
+
+static size_t kv_identical(const t_layout_lines *lines)
+{
+  t_bits full_line = bits_full(lines->size);
+  size_t pairs = 0;
+  for (int first = 0; first < lines->count; first += lines->size)
+    for (int k = first; k < first + lines->size; k++)
+    {
+      if (!kvline_is_full(lines->kv[k], full_line))
+        continue;
+      for (int l = first; l < k; l++)
+        pairs += kvline_is_full(lines->kv[l], full_line) &&
+                 kvline_identical_full(lines->kv[k], lines->kv[l]);
+    }
+  return pairs;
+}
+
+/* Lines with too many zeros or ones. */
+static size_t zo_counts(const t_layout_lines *lines)
+{
+  size_t over = 0;
+  for (int k = 0; k < lines->count; k++)
+    over += binline_too_many(lines->zo[k], lines->size);
+  return over;
+}
+
+static size_t kv_counts(const t_layout_lines *lines)
+{
+  size_t over = 0;
+  for (int k = 0; k < lines->count; k++)
+    over += kvline_too_many(lines->kv[k], lines->size);
+  return over;
+}
+
+/* Not const, so the calls are not inlined in the timing loop. */
+static layout_kernel layout_kernels[][2] = {{zo_full, kv_full},
+                                            {zo_empty, kv_empty},
+                                            {zo_identical, kv_identical},
+                                            {zo_counts, kv_counts}};
+static const char *layout_kernel_names[] = {"full", "empty", "identical",
+                                            "counts"};
+#define LAYOUT_KERNELS (sizeof(layout_kernels) / sizeof(layout_kernels[0]))
+
+static volatile size_t layout_sink;
+
+/* Adds the lines and columns of `grid` to both layouts of `lines`. */
+static void layout_add(t_layout_lines *lines, const t_grid *grid)
+{
+  for (int k = 0; k < grid->size; k++)
+  {
+    const binline *rows[2] = {&grid->lines[k], &grid->columns[k]};
+    for (int axis = LINE; axis <= COLUMN; axis++)
+    {
+      memcpy(lines->zo[lines->count], *rows[axis], sizeof(binline));
+      lines->kv[lines->count] = kvline_from_binline(*rows[axis]);
+      lines->count++;
+    }
+  }
+}
+
+/* Times the kernels on the puzzle `grid`, after its propagation and once
+ * solved (if the solver finds a solution within the budget), and adds
+ * the times to `totals`. */
+static void layout_grid(const char *name, const t_grid *grid,
+                        double totals[][2])
+{
+  static t_layout_lines lines;
+  lines.count = 0;
+  lines.size = grid->size;
+  layout_add(&lines, grid);
+
+  t_grid work;
+  grid_copy(grid, &work);
+  grid_mark_dirty(&work);
+  if (grid_heuristics(&work))
+  {
+    layout_add(&lines, &work);
+
+    t_solver solver;
+    if (!solver_init(&solver, &work, NULL, MODE_FIRST, false))
+      errx(EXIT_FAILURE, "error: can't initialize the solver");
+    solver.max_nodes = NODES_BUDGET;
+    if (trail_solver(&solver, &work))
+      layout_add(&lines, &work);
+    solver_free(&solver);
+  }
+
+  for (size_t r = 0; r < LAYOUT_KERNELS; r++)
+  {
+    double times[2];
+    size_t checksums[2];
+    for (int l = 0; l < 2; l++)
+    {
+      checksums[l] = 0;
+      double start = now();
+      for (int pass = 0; pass < LAYOUT_PASSES; pass++)
+        checksums[l] += layout_kernels[r][l](&lines);
+      times[l] = now() - start;
+      totals[r][l] += times[l];
+    }
+    layout_sink = checksums[0];
+
+    if (checksums[0] != checksums[1])
+      errx(EXIT_FAILURE, "error: the layouts disagree on %s of %s",
+           layout_kernel_names[r], name);
+
+    printf("%-48s %6d %-10s %12.1f %12.1f %8.2f\n", name, grid->size,
+           layout_kernel_names[r], times[0] * 1e9 / LAYOUT_PASSES / lines.count,
+           times[1] * 1e9 / LAYOUT_PASSES / lines.count, times[0] / times[1]);
+  }
+}
+
+/* A/B comparison of the zeros/ones and known/value layouts of the lines on
+ * the kernels of the solver, in ns per line. Without files, generated
+ * 64x64 puzzles follow the grids of tests/. */
+static void bench_layout(char **filenames, bool generated)
+{
+  double totals[LAYOUT_KERNELS][2] = {{0}};
+
+  printf("# layout: line kernels, %d passes over the lines of each grid\n",
+         LAYOUT_PASSES);
+  printf("%-48s %6s %-10s %12s %12s %8s\n", "grid", "size", "kernel",
+         "zeros/ones", "known/value", "speedup");
+
+  for (int i = 0; filenames[i] != NULL; i++)
+  {
+    t_grid *grid = file_parser(filenames[i]);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: error with file %s", filenames[i]);
+    layout_grid(filenames[i], grid, totals);
+    free(grid);
+  }
+
+  t_gen_config config = {.size = 64,
+                         .unique = true,
+                         .difficulty = DIFFICULTY_NONE,
+                         .minimize = false,
+                         .threads = 1,
+                         .seed = LAYOUT_SEED};
+  for (int k = 0; generated && k < LAYOUT_PUZZLES; k++)
+  {
+    t_gen_stats stats;
+    t_grid *grid = puzzle_generate(&config, k, &stats);
+    if (grid == NULL)
+      errx(EXIT_FAILURE, "error: can't generate a 64x64 puzzle");
+
+    char name[32];
+    snprintf(name, sizeof(name), "generated 64x64 #%d", k);
+    layout_grid(name, grid, totals);
+    free(grid);
+  }
+
+  for (size_t r = 0; r < LAYOUT_KERNELS; r++)
+    printf("%-48s %6s %-10s %12.4f %12.4f %8.2f\n", "total (s)", "",
+           layout_kernel_names[r], totals[r][0], totals[r][1],
+           totals[r][0] / totals[r][1]);
+  printf("\n");
+}
+
+/* Without argument every benchmark is run. */
+static bool selected(int argc, char *argv[], const char *name)
+{
+  return (argc < 2) || (strcmp(argv[1], name) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+  bool found = false;
+
+  if (selected(argc, argv, "threads"))
+  {
+    char *filename = (argc > 2) ? argv[2] : DEFAULT_THREADS_GRID;
+    int max_threads = (argc > 3) ? strtol(argv[3], NULL, 10)
+                                 : parallel_threads();
+    bench_threads(filename, max_threads);
+    found = true;
+  }
+
+  if (selected(argc, argv, "nodes"))
+  {
+    bench_nodes((argc > 2) ? argv + 2 : default_grids);
+    found = true;
+  }
+
+  if (selected(argc, argv, "propagation"))
+  {
+    bench_propagation((argc > 2) ? argv + 2 : default_grids);
+    found = true;
+  }
+
+  if (selected(argc, argv, "branching"))
+  {
+    bench_branching((argc > 2) ? argv + 2 : corpus_grids);
+    found = true;
+  }
+
+  if (selected(argc, argv, "engines"))
+  {
+    bench_engines((argc > 2) ? argv + 2 : corpus_grids);
+    found = true;
+  }
+
+  if (selected(argc, argv, "layout"))
+  {
+    bench_layout((argc > 2) ? argv + 2 : corpus_grids, argc <= 2);
+    found = true;
+  }
+
+  if (!found)
+  {
+    print_help();
+    return (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+#include "branching.h"
+
+#include <string.h>
+
+#include <lines.h>
+
+const char *branching_names[BRANCH_COUNT] = {"filled", "balance",
+                                             "constrained", "lookahead"};
+
+branching_t branching_from_name(const char *name)
+{
+  for (int strategy = 0; strategy < BRANCH_COUNT; strategy++)
+  {
+    if (strcmp(name, branching_names[strategy]) == 0)
+      return strategy;
+  }
+
+  return BRANCH_COUNT;
+}
+
+/* Returns the value still needed the most by the line and the column of
+ * the cell, the value of grid_choice on a tie. */
+static char balance_value(t_grid *grid, int row, int column)
+{
+  int ones = grid->counts[LINE][row][1] + grid->counts[COLUMN][column][1];
+  int zeros = grid->counts[LINE][row][0] + grid->counts[COLUMN][column][0];
+
+  if (ones == zeros)
+    return (column % 2) + ZERO;
+
+  return (ones < zeros) ? ONE : ZERO;
+}
+
+/* Finds the line or column which isn't full and has the fewest legal
+ * completions, the first one which isn't full when the counts saturate.
+ * The grid mustn't be full. */
+static void constrained_line(t_grid *grid, axis_mode *axis, int *k)
+{
+  binline *axes[2] = {grid->lines, grid->columns};
+  t_bits full_line = bits_full(grid->size);
+  uint64_t best = UINT64_MAX;
+  bool found = false;
+
+  for (axis_mode mode = LINE; mode <= COLUMN; mode++)
+  {
+    for (int i = 0; i < grid->size; i++)
+    {
+      if (bits_equal(bits_or(axes[mode][i][0], axes[mode][i][1]), full_line))
+        continue;
+
+      uint64_t count = line_completions(axes[mode][i], grid->size);
+      if (!found || count < best)
+      {
+        found = true;
+        best = count;
+        *axis = mode;
+        *k = i;
+      }
+    }
+  }
+
+  if (!found)
+    errx(EXIT_FAILURE, "error: constrained_line but grid is full");
+}
+
+/* Returns the cell (row, column) of position j on line k of `axis`. */
+static choice_t cell_of(axis_mode axis, int k, int j)
+{
+  choice_t choice;
+  choice.row = (axis == LINE) ? k : j;
+  choice.column = (axis == LINE) ? j : k;
+  choice.choice = EMPTY_CELL;
+
+  return choice;
+}
+
+/* In the most constrained line, the cell whose crossing line is the most
+ * constrained too. */
+static choice_t constrained_choice(t_grid *grid)
+{
+  binline *axes[2] = {grid->lines, grid->columns};
+  axis_mode axis = LINE;
+  int k = 0;
+  constrained_line(grid, &axis, &k);
+
+  binline *crossing = axes[(axis + 1) % 2];
+  t_bits empty = bits_andnot(bits_full(grid->size),
+                             bits_or(axes[axis][k][0], axes[axis][k][1]));
+  uint64_t best = UINT64_MAX;
+  int best_j = bits_lowest(empty);
+
+  while (bits_any(empty))
+  {
+    int j = bits_pop(&empty);
+    uint64_t count = line_completions(crossing[j], grid->size);
+    if (count < best)
+    {
+      best = count;
+      best_j = j;
+    }
+  }
+
+  choice_t choice = cell_of(axis, k, best_j);
+  choice.choice = balance_value(grid, choice.row, choice.column);
+
+  return choice;
+}
+
+static int filled_cells(t_grid *grid)
+{
+  int count = 0;
+  for (int i = 0; i < grid->size; i++)
+    count += grid->counts[LINE][i][0] + grid->counts[LINE][i][1];
+
+  return count;
+}
+
+/* Tries both values of each empty cell of the most constrained line and
+ * keeps the cell which forces the most cells on both sides, its value
+ * forcing the most first. A value which makes the grid inconsistent is
+ * returned at once : its branch dies on the first node. */
+static choice_t lookahead_choice(t_grid *grid, t_grid *scratch)
+{
+  binline *axes[2] = {grid->lines, grid->columns};
+  axis_mode axis = LINE;
+  int k = 0;
+  constrained_line(grid, &axis, &k);
+
+  t_bits empty = bits_andnot(bits_full(grid->size),
+                             bits_or(axes[axis][k][0], axes[axis][k][1]));
+  int filled = filled_cells(grid);
+  long best_score = -1;
+  choice_t best = cell_of(axis, k, bits_lowest(empty));
+
+  while (bits_any(empty))
+  {
+    choice_t choice = cell_of(axis, k, bits_pop(&empty));
+    int forced[2];
+
+    for (int value = 0; value < 2; value++)
+    {
+      choice.choice = value + ZERO;
+      grid_copy(grid, scratch);
+      grid_choice_apply(scratch, choice);
+
+      if (!grid_heuristics(scratch))
+        return choice;
+
+      forced[value] = filled_cells(scratch) - filled;
+    }
+
+    long score = (long)(forced[0] + 1) * (forced[1] + 1);
+    if (score > best_score)
+    {
+      best_score = score;
+      best = choice;
+      best.choice = ((forced[1] > forced[0]) ? 1 : 0) + ZERO;
+    }
+  }
+
+  return best;
+}
+
+choice_t branching_choice(t_grid *grid, branching_t strategy, t_grid *scratch)
+{
+  if (is_full(grid))
+  {
+    errx(EXIT_FAILURE, "error: branching_choice but grid is full ");
+  }
+
+  choice_t choice;
+
+  switch (strategy)
+  {
+  case BRANCH_BALANCE:
+    choice = grid_choice(grid);
+    choice.choice = balance_value(grid, choice.row, choice.column);
+    return choice;
+
+  case BRANCH_CONSTRAINED:
+    return constrained_choice(grid);
+
+  case BRANCH_LOOKAHEAD:
+    return lookahead_choice(grid, scratch);
+
+  default:
+    return grid_choice(grid);
+  }
+}
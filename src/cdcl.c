@@ -0,0 +1,930 @@
+#include "cdcl.h"
+
+#include <string.h>
+
+
+/* A literal is 2 * var + negated, the variable of cell (i, j) is
+ * i * size + j and is true when the cell is ONE. */
+#define var_of(lit) ((lit) >> 1)
+#define lit_of(var, value) (2 * (var) + ((value) ? 0 : 1))
+
+/* Reasons : a clause of the database (>= 0), a temporary explanation of a
+ * native propagator (<= -2) or none for decisions. */
+#define NO_REASON (-1)
+#define explain_ref(index) (-(index)-2)
+#define explain_index(ref) (-(ref)-2)
+
+/* Header of the clauses of the database : size, then flags. */
+#define LEARNT 1
+#define DELETED 2
+#define lbd_of(flags) ((flags) >> 2)
+
+typedef struct
+{
+  int *data;
+  int size;
+  int capacity;
+} t_vec;
+
+typedef struct
+{
+  int size; /* Of the grid. */
+  int vars;
+
+  int8_t *value; /* -1 if unassigned, else the value of the cell. */
+  int8_t *phase; /* Last value of each variable. */
+  int *level;
+  int *reason;
+  int *trail;
+  int trail_size;
+  int qhead;
+  int *trail_lim;   /* Start of each decision level in the trail. */
+  int *explain_lim; /* Size of `explain` at the start of each level. */
+  int levels;
+
+  t_vec clauses; /* Database : [size][flags][literals]... */
+  t_vec explain; /* Temporary reasons : [size][literals]..., a stack. */
+  t_vec *watches; /* Clauses watching each literal. */
+  int learnts;
+
+  /* Values of the assigned cells, as in t_grid. */
+  binline lines[MAX_GRID_SIZE];
+  binline columns[MAX_GRID_SIZE];
+
+  double *activity;
+  double increment;
+  int *heap;       /* Unassigned variables, max-heap on activity. */
+  int *heap_index; /* Position in `heap`, -1 if absent. */
+  int heap_size;
+
+  int8_t *seen;       /* Variables met by the conflict analysis. */
+  int8_t *level_seen; /* Levels met while computing an LBD. */
+  t_vec learnt;
+} t_cdcl;
+
+/* ------------------------ VECTORS ------------------------ */
+
+static void vec_push(t_vec *vec, int x)
+{
+  if (vec->size == vec->capacity)
+  {
+    int capacity = vec->capacity ? 2 * vec->capacity : 8;
+    int *data = realloc(vec->data, capacity * sizeof(int));
+    if (data == NULL)
+      errx(EXIT_FAILURE, "error: cdcl realloc");
+    vec->data = data;
+    vec->capacity = capacity;
+  }
+  vec->data[vec->size++] = x;
+}
+
+/* ------------------------ VSIDS ------------------------ */
+
+static inline bool heap_before(t_cdcl *s, int a, int b)
+{
+  return s->activity[a] > s->activity[b];
+}
+
+static void heap_up(t_cdcl *s, int i)
+{
+  int var = s->heap[i];
+  while (i > 0 && heap_before(s, var, s->heap[(i - 1) / 2]))
+  {
+    s->heap[i] = s->heap[(i - 1) / 2];
+    s->heap_index[s->heap[i]] = i;
+    i = (i - 1) / 2;
+  }
+  s->heap[i] = var;
+  s->heap_index[var] = i;
+}
+
+static void heap_down(t_cdcl *s, int i)
+{
+  int var = s->heap[i];
+  while (2 * i + 1 < s->heap_size)
+  {
+    int child = 2 * i + 1;
+    if (child + 1 < s->heap_size &&
+        heap_before(s, s->heap[child + 1], s->heap[child]))
+      child++;
+    if (!heap_before(s, s->heap[child], var))
+      break;
+    s->heap[i] = s->heap[child];
+    s->heap_index[s->heap[i]] = i;
+    i = child;
+  }
+  s->heap[i] = var;
+  s->heap_index[var] = i;
+}
+
+static void heap_insert(t_cdcl *s, int var)
+{
+  if (s->heap_index[var] >= 0)
+    return;
+  s->heap[s->heap_size] = var;
+  s->heap_index[var] = s->heap_size;
+  heap_up(s, s->heap_size++);
+}
+
+static int heap_pop(t_cdcl *s)
+{
+  int var = s->heap[0];
+  s->heap_index[var] = -1;
+  if (--s->heap_size > 0)
+  {
+    s->heap[0] = s->heap[s->heap_size];
+    heap_down(s, 0);
+  }
+  return var;
+}
+
+static void bump(t_cdcl *s, int var)
+{
+  s->activity[var] += s->increment;
+  if (s->activity[var] > 1e100)
+  {
+    for (int v = 0; v < s->vars; v++)
+      s->activity[v] *= 1e-100;
+    s->increment *= 1e-100;
+  }
+  if (s->heap_index[var] >= 0)
+    heap_up(s, s->heap_index[var]);
+}
+
+/* ------------------------ ASSIGNMENT ------------------------ */
+
+/* 1 if `lit` is true, 0 if it is false, -1 if it is unassigned. */
+static inline int lit_value(t_cdcl *s, int lit)
+{
+  int value = s->value[var_of(lit)];
+  return (value < 0) ? -1 : (value ^ (lit & 1));
+}
+
+static void enqueue(t_cdcl *s, int lit, int reason)
+{
+  int var = var_of(lit);
+  int value = !(lit & 1);
+  int i = var / s->size;
+  int j = var % s->size;
+
+  s->value[var] = value;
+  s->level[var] = s->levels;
+  s->reason[var] = reason;
+  s->trail[s->trail_size++] = lit;
+  bits_set(&s->lines[i][value], j);
+  bits_set(&s->columns[j][value], i);
+}
+
+static void backtrack(t_cdcl *s, int level)
+{
+  if (s->levels <= level)
+    return;
+
+  for (int t = s->trail_size - 1; t >= s->trail_lim[level]; t--)
+  {
+    int var = var_of(s->trail[t]);
+    int i = var / s->size;
+    int j = var % s->size;
+
+    s->phase[var] = s->value[var];
+    bits_reset(&s->lines[i][s->value[var]], j);
+    bits_reset(&s->columns[j][s->value[var]], i);
+    s->value[var] = -1;
+    heap_insert(s, var);
+  }
+
+  s->trail_size = s->trail_lim[level];
+  s->qhead = s->trail_size;
+  s->explain.size = s->explain_lim[level];
+  s->levels = level;
+}
+
+static void new_level(t_cdcl *s)
+{
+  s->trail_lim[s->levels] = s->trail_size;
+  s->explain_lim[s->levels] = s->explain.size;
+  s->levels++;
+}
+
+/* ------------------------ CLAUSES ------------------------ */
+
+static inline int *clause_lits(t_cdcl *s, int ref, int *size)
+{
+  if (ref >= 0)
+  {
+    *size = s->clauses.data[ref];
+    return &s->clauses.data[ref + 2];
+  }
+
+  int index = explain_index(ref);
+  *size = s->explain.data[index];
+  return &s->explain.data[index + 1];
+}
+
+/* Adds a clause of at least 2 literals to the database, the first two are
+ * watched. */
+static int add_clause(t_cdcl *s, const int *lits, int size, int flags)
+{
+  int ref = s->clauses.size;
+
+  vec_push(&s->clauses, size);
+  vec_push(&s->clauses, flags);
+  for (int k = 0; k < size; k++)
+    vec_push(&s->clauses, lits[k]);
+
+  vec_push(&s->watches[lits[0]], ref);
+  vec_push(&s->watches[lits[1]], ref);
+  if (flags & LEARNT)
+    s->learnts++;
+
+  return ref;
+}
+
+/* Explanations are built literal after literal on top of `explain`. */
+static int explain_begin(t_cdcl *s)
+{
+  int index = s->explain.size;
+  vec_push(&s->explain, 0);
+  return index;
+}
+
+static inline void explain_add(t_cdcl *s, int index, int lit)
+{
+  vec_push(&s->explain, lit);
+  s->explain.data[index]++;
+}
+
+/* ------------------------ NATIVE PROPAGATORS ------------------------ */
+
+static inline int line_var(t_cdcl *s, axis_mode axis, int k, int pos)
+{
+  return (axis == LINE) ? k * s->size + pos : pos * s->size + k;
+}
+
+/* Literal true when cell `pos` of line k has its current value. */
+static inline int line_lit(t_cdcl *s, axis_mode axis, int k, int pos)
+{
+  int var = line_var(s, axis, k, pos);
+  return lit_of(var, s->value[var]);
+}
+
+/* Half of the cells of the line are `value` : the other cells get the
+ * opposite, more than half is a conflict. Returns the explanation of the
+ * conflict or NO_REASON. */
+static int cardinality(t_cdcl *s, axis_mode axis, int k)
+{
+  binline *line = (axis == LINE) ? &s->lines[k] : &s->columns[k];
+  int half = s->size / 2;
+
+  for (int value = 0; value < 2; value++)
+  {
+    int count = gridline_count((*line)[value]);
+    t_bits empty =
+        bits_andnot(bits_full(s->size), bits_or((*line)[0], (*line)[1]));
+
+    if (count < half || (count == half && !bits_any(empty)))
+      continue;
+
+    if (count > half)
+    {
+      int index = explain_begin(s);
+      t_bits cells = (*line)[value];
+      for (int n = 0; n <= half; n++)
+        explain_add(s, index, line_lit(s, axis, k, bits_pop(&cells)) ^ 1);
+      return explain_ref(index);
+    }
+
+    while (bits_any(empty))
+    {
+      int forced = lit_of(line_var(s, axis, k, bits_pop(&empty)), !value);
+      int index = explain_begin(s);
+      explain_add(s, index, forced);
+      for (t_bits cells = (*line)[value]; bits_any(cells);)
+        explain_add(s, index, line_lit(s, axis, k, bits_pop(&cells)) ^ 1);
+      enqueue(s, forced, explain_ref(index));
+    }
+  }
+
+  return NO_REASON;
+}
+
+/* Line k and line r of the axis have the same values on every cell but
+ * `pos` : explains them, without `pos` in line r. */
+static void explain_equal(t_cdcl *s, int index, axis_mode axis, int k, int r,
+                          int pos)
+{
+  for (int q = 0; q < s->size; q++)
+  {
+    explain_add(s, index, line_lit(s, axis, k, q) ^ 1);
+    if (q != pos)
+      explain_add(s, index, line_lit(s, axis, r, q) ^ 1);
+  }
+}
+
+/* Compares line k, which has at most one empty cell, with the other lines
+ * of the axis in the same case : two full identical lines are a conflict,
+ * a line which can only become identical to a full one gets the other
+ * value on its empty cell. */
+static int distinct(t_cdcl *s, axis_mode axis, int k)
+{
+  binline *axis_lines = (axis == LINE) ? s->lines : s->columns;
+  t_bits full_line = bits_full(s->size);
+
+  for (int r = 0; r < s->size; r++)
+  {
+    t_bits empty_k =
+        bits_andnot(full_line, bits_or(axis_lines[k][0], axis_lines[k][1]));
+    t_bits empty_r =
+        bits_andnot(full_line, bits_or(axis_lines[r][0], axis_lines[r][1]));
+    t_bits empty = bits_or(empty_k, empty_r);
+
+    if (r == k || (bits_any(empty_k) && bits_any(empty_r)) ||
+        gridline_count(empty) > 1)
+      continue;
+
+    t_bits both = bits_andnot(full_line, empty);
+    if (bits_any(bits_and(bits_xor(axis_lines[k][1], axis_lines[r][1]), both)))
+      continue;
+
+    if (!bits_any(empty))
+    {
+      int index = explain_begin(s);
+      explain_equal(s, index, axis, k, r, -1);
+      return explain_ref(index);
+    }
+
+    /* `open` has one empty cell at `pos`, `full` has none. */
+    int open = bits_any(empty_k) ? k : r;
+    int full = bits_any(empty_k) ? r : k;
+    int pos = bits_lowest(empty);
+    int value = bits_test(axis_lines[full][1], pos);
+    int forced = lit_of(line_var(s, axis, open, pos), !value);
+
+    int index = explain_begin(s);
+    explain_add(s, index, forced);
+    explain_equal(s, index, axis, full, open, pos);
+    enqueue(s, forced, explain_ref(index));
+  }
+
+  return NO_REASON;
+}
+
+static int native_propagate(t_cdcl *s, int var)
+{
+  int i = var / s->size;
+  int j = var % s->size;
+  t_bits full_line = bits_full(s->size);
+  int conflict;
+
+  if ((conflict = cardinality(s, LINE, i)) != NO_REASON)
+    return conflict;
+  if ((conflict = cardinality(s, COLUMN, j)) != NO_REASON)
+    return conflict;
+
+  if (gridline_count(bits_andnot(full_line, bits_or(s->lines[i][0],
+                                                    s->lines[i][1]))) <= 1 &&
+      (conflict = distinct(s, LINE, i)) != NO_REASON)
+    return conflict;
+  if (gridline_count(bits_andnot(full_line, bits_or(s->columns[j][0],
+                                                    s->columns[j][1]))) <= 1 &&
+      (conflict = distinct(s, COLUMN, j)) != NO_REASON)
+    return conflict;
+
+  return NO_REASON;
+}
+
+/* ------------------------ SEARCH ------------------------ */
+
+/* Unit propagation of the clauses and of the native propagators, returns
+ * the conflicting clause or NO_REASON. */
+static int propagate(t_cdcl *s)
+{
+  while (s->qhead < s->trail_size)
+  {
+    int lit = s->trail[s->qhead++];
+    int false_lit = lit ^ 1;
+    t_vec *watches = &s->watches[false_lit];
+    int i = 0;
+    int j = 0;
+
+    while (i < watches->size)
+    {
+      int ref = watches->data[i++];
+      int size = s->clauses.data[ref];
+      int *c = &s->clauses.data[ref + 2];
+
+      if (c[0] == false_lit)
+      {
+        c[0] = c[1];
+        c[1] = false_lit;
+      }
+
+      if (lit_value(s, c[0]) == 1)
+      {
+        watches->data[j++] = ref;
+        continue;
+      }
+
+      bool moved = false;
+      for (int k = 2; k < size; k++)
+      {
+        if (lit_value(s, c[k]) != 0)
+        {
+          c[1] = c[k];
+          c[k] = false_lit;
+          vec_push(&s->watches[c[1]], ref);
+          moved = true;
+          break;
+        }
+      }
+      if (moved)
+        continue;
+
+      watches->data[j++] = ref;
+      if (lit_value(s, c[0]) == 0)
+      {
+        while (i < watches->size)
+          watches->data[j++] = watches->data[i++];
+        watches->size = j;
+        return ref;
+      }
+      enqueue(s, c[0], ref);
+    }
+    watches->size = j;
+
+    int conflict = native_propagate(s, var_of(lit));
+    if (conflict != NO_REASON)
+      return conflict;
+  }
+
+  return NO_REASON;
+}
+
+/* Removes the literals of `learnt` implied by the other ones through
+ * their reason. They are marked with 2 in `seen` first, so that `seen`
+ * can be cleared for all of them afterwards. */
+static void minimize(t_cdcl *s)
+{
+  for (int k = 1; k < s->learnt.size; k++)
+  {
+    int var = var_of(s->learnt.data[k]);
+    int reason = s->reason[var];
+    if (reason == NO_REASON)
+      continue;
+
+    int size;
+    int *lits = clause_lits(s, reason, &size);
+    bool redundant = true;
+    for (int q = 0; q < size && redundant; q++)
+    {
+      int other = var_of(lits[q]);
+      if (other != var && !s->seen[other] && s->level[other] > 0)
+        redundant = false;
+    }
+
+    if (redundant)
+      s->seen[var] = 2;
+  }
+
+  int kept = 1;
+  for (int k = 1; k < s->learnt.size; k++)
+  {
+    int var = var_of(s->learnt.data[k]);
+    if (s->seen[var] == 1)
+      s->learnt.data[kept++] = s->learnt.data[k];
+    s->seen[var] = 0;
+  }
+  s->learnt.size = kept;
+}
+
+/* First unique implication point : fills `learnt` with the asserting
+ * literal first and returns the level to backjump to. */
+static int analyze(t_cdcl *s, int conflict)
+{
+  int paths = 0;
+  int lit = -1;
+  int t = s->trail_size - 1;
+  int ref = conflict;
+
+  s->learnt.size = 0;
+  vec_push(&s->learnt, 0);
+
+  do
+  {
+    int size;
+    int *lits = clause_lits(s, ref, &size);
+
+    for (int k = 0; k < size; k++)
+    {
+      int var = var_of(lits[k]);
+      if ((lit >= 0 && var == var_of(lit)) || s->seen[var] ||
+          s->level[var] == 0)
+        continue;
+
+      s->seen[var] = 1;
+      bump(s, var);
+      if (s->level[var] >= s->levels)
+        paths++;
+      else
+        vec_push(&s->learnt, lits[k]);
+    }
+
+    while (!s->seen[var_of(s->trail[t])])
+      t--;
+    lit = s->trail[t--];
+    ref = s->reason[var_of(lit)];
+    s->seen[var_of(lit)] = 0;
+    paths--;
+  } while (paths > 0);
+
+  s->learnt.data[0] = lit ^ 1;
+  minimize(s);
+
+  /* The literal of the highest level after the asserting one is watched
+   * second, it is the level to go back to. */
+  int level = 0;
+  for (int k = 1; k < s->learnt.size; k++)
+  {
+    if (s->level[var_of(s->learnt.data[k])] > level)
+    {
+      level = s->level[var_of(s->learnt.data[k])];
+      int swap = s->learnt.data[1];
+      s->learnt.data[1] = s->learnt.data[k];
+      s->learnt.data[k] = swap;
+    }
+  }
+
+  return level;
+}
+
+/* Literal block distance : number of distinct levels of the learned
+ * clause. */
+static int learnt_lbd(t_cdcl *s)
+{
+  int lbd = 0;
+  for (int k = 0; k < s->learnt.size; k++)
+  {
+    int level = s->level[var_of(s->learnt.data[k])];
+    if (!s->level_seen[level])
+    {
+      s->level_seen[level] = 1;
+      lbd++;
+    }
+  }
+  for (int k = 0; k < s->learnt.size; k++)
+    s->level_seen[s->level[var_of(s->learnt.data[k])]] = 0;
+
+  return lbd;
+}
+
+typedef struct
+{
+  int lbd;
+  int ref;
+} t_ranked;
+
+/* Worst clauses first. */
+static int compare_ranked(const void *a, const void *b)
+{
+  return ((const t_ranked *)b)->lbd - ((const t_ranked *)a)->lbd;
+}
+
+/* Deletes the worst half of the learned clauses, keeping the clauses with
+ * an LBD of 2 and the reasons of assigned literals, then compacts the
+ * database and rebuilds the watches. */
+static void reduce(t_cdcl *s)
+{
+  t_ranked *ranked = malloc(s->learnts * sizeof(t_ranked));
+  int *forward = malloc(s->clauses.size * sizeof(int));
+  if (ranked == NULL || forward == NULL)
+    errx(EXIT_FAILURE, "error: cdcl malloc");
+
+  int count = 0;
+  for (int ref = 0; ref < s->clauses.size; ref += 2 + s->clauses.data[ref])
+  {
+    int flags = s->clauses.data[ref + 1];
+    if (flags & LEARNT)
+      ranked[count++] = (t_ranked){lbd_of(flags), ref};
+  }
+  qsort(ranked, count, sizeof(t_ranked), compare_ranked);
+
+  for (int k = 0; k < count / 2; k++)
+  {
+    int ref = ranked[k].ref;
+    int first = s->clauses.data[ref + 2];
+    bool locked =
+        lit_value(s, first) == 1 && s->reason[var_of(first)] == ref;
+
+    if (!locked && ranked[k].lbd > 2)
+    {
+      s->clauses.data[ref + 1] |= DELETED;
+      s->learnts--;
+    }
+  }
+  free(ranked);
+
+  int size = 0;
+  for (int ref = 0; ref < s->clauses.size;)
+  {
+    int length = 2 + s->clauses.data[ref];
+    if (!(s->clauses.data[ref + 1] & DELETED))
+    {
+      forward[ref] = size;
+      memmove(&s->clauses.data[size], &s->clauses.data[ref],
+              length * sizeof(int));
+      size += length;
+    }
+    ref += length;
+  }
+  s->clauses.size = size;
+
+  for (int t = 0; t < s->trail_size; t++)
+  {
+    int var = var_of(s->trail[t]);
+    if (s->reason[var] >= 0)
+      s->reason[var] = forward[s->reason[var]];
+  }
+  free(forward);
+
+  for (int lit = 0; lit < 2 * s->vars; lit++)
+    s->watches[lit].size = 0;
+  for (int ref = 0; ref < s->clauses.size; ref += 2 + s->clauses.data[ref])
+  {
+    vec_push(&s->watches[s->clauses.data[ref + 2]], ref);
+    vec_push(&s->watches[s->clauses.data[ref + 3]], ref);
+  }
+}
+
+/* Luby sequence : 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ... */
+static size_t luby(size_t x)
+{
+  size_t size = 1;
+  int seq = 0;
+  while (size < x + 1)
+  {
+    seq++;
+    size = 2 * size + 1;
+  }
+  while (size - 1 != x)
+  {
+    size = (size - 1) >> 1;
+    seq--;
+    x = x % size;
+  }
+
+  return (size_t)1 << seq;
+}
+
+/* ------------------------ SETUP ------------------------ */
+
+static void *cdcl_calloc(size_t count, size_t size)
+{
+  void *ptr = calloc(count, size);
+  if (ptr == NULL)
+    errx(EXIT_FAILURE, "error: cdcl calloc");
+
+  return ptr;
+}
+
+/* Variables, no three in a row clauses and clues at level 0. Returns false
+ * if the clues are already inconsistent. */
+static bool cdcl_init(t_cdcl *s, t_grid *grid)
+{
+  memset(s, 0, sizeof(t_cdcl));
+  s->size = grid->size;
+  s->vars = grid->size * grid->size;
+  s->increment = 1;
+
+  s->value = cdcl_calloc(s->vars, sizeof(int8_t));
+  s->phase = cdcl_calloc(s->vars, sizeof(int8_t));
+  s->level = cdcl_calloc(s->vars, sizeof(int));
+  s->reason = cdcl_calloc(s->vars, sizeof(int));
+  s->trail = cdcl_calloc(s->vars, sizeof(int));
+  s->trail_lim = cdcl_calloc(s->vars + 1, sizeof(int));
+  s->explain_lim = cdcl_calloc(s->vars + 1, sizeof(int));
+  s->watches = cdcl_calloc(2 * s->vars, sizeof(t_vec));
+  s->activity = cdcl_calloc(s->vars, sizeof(double));
+  s->heap = cdcl_calloc(s->vars, sizeof(int));
+  s->heap_index = cdcl_calloc(s->vars, sizeof(int));
+  s->seen = cdcl_calloc(s->vars, sizeof(int8_t));
+  s->level_seen = cdcl_calloc(s->vars + 1, sizeof(int8_t));
+
+  for (int var = 0; var < s->vars; var++)
+  {
+    s->value[var] = -1;
+    s->heap_index[var] = -1;
+    heap_insert(s, var);
+  }
+
+  /* Two clauses per three consecutive cells : not all ZERO, not all ONE. */
+  for (int i = 0; i < s->size; i++)
+  {
+    for (int j = 0; j + 2 < s->size; j++)
+    {
+      for (axis_mode axis = LINE; axis <= COLUMN; axis++)
+      {
+        for (int value = 0; value < 2; value++)
+        {
+          int lits[3];
+          for (int k = 0; k < 3; k++)
+            lits[k] = lit_of(line_var(s, axis, i, j + k), value);
+          add_clause(s, lits, 3, 0);
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < s->size; i++)
+  {
+    for (int value = 0; value < 2; value++)
+    {
+      for (t_bits cells = grid->lines[i][value]; bits_any(cells);)
+      {
+        int var = i * s->size + bits_pop(&cells);
+        if (s->value[var] >= 0)
+          return false;
+        enqueue(s, lit_of(var, value), NO_REASON);
+      }
+    }
+  }
+
+  return true;
+}
+
+static void cdcl_free(t_cdcl *s)
+{
+  for (int lit = 0; lit < 2 * s->vars; lit++)
+    free(s->watches[lit].data);
+
+  free(s->value);
+  free(s->phase);
+  free(s->level);
+  free(s->reason);
+  free(s->trail);
+  free(s->trail_lim);
+  free(s->explain_lim);
+  free(s->watches);
+  free(s->activity);
+  free(s->heap);
+  free(s->heap_index);
+  free(s->seen);
+  free(s->level_seen);
+  free(s->clauses.data);
+  free(s->explain.data);
+  free(s->learnt.data);
+}
+
+/* ------------------------ SOLVER ------------------------ */
+
+static void print_solution(t_solver *solver, t_grid *grid)
+{
+  if (solver->fd)
+    fprintf(solver->fd, "\nSolution ");
+
+  if (solver->mode)
+  {
+    solver->stats.solutions++;
+    if (solver->fd)
+      fprintf(solver->fd, "%ld:", solver->stats.solutions);
+  }
+
+  if (solver->fd)
+  {
+    fprintf(solver->fd, "\n");
+    grid_print(grid, solver->fd);
+  }
+}
+
+/* Forbids the decisions which led to the current solution and goes back
+ * to the level of the last one with its opposite. Returns false when there
+ * were no decisions : the search space is exhausted. */
+static bool block_solution(t_cdcl *s)
+{
+  if (s->levels == 0)
+    return false;
+
+  s->learnt.size = 0;
+  for (int level = s->levels - 1; level >= 0; level--)
+    vec_push(&s->learnt, s->trail[s->trail_lim[level]] ^ 1);
+
+  backtrack(s, s->levels - 1);
+  if (s->learnt.size == 1)
+    enqueue(s, s->learnt.data[0], NO_REASON);
+  else
+    enqueue(s, s->learnt.data[0],
+            add_clause(s, s->learnt.data, s->learnt.size, 0));
+
+  return true;
+}
+
+static int pick_variable(t_cdcl *s)
+{
+  while (s->heap_size > 0)
+  {
+    int var = heap_pop(s);
+    if (s->value[var] < 0)
+      return var;
+  }
+
+  return -1;
+}
+
+static bool cdcl_search(t_cdcl *s, t_solver *solver, t_grid *grid)
+{
+  bool found = false;
+  size_t conflicts = 0;
+  size_t restarts = 0;
+  int reduce_limit = CDCL_FIRST_REDUCE;
+
+  for (;;)
+  {
+    int conflict = propagate(s);
+    if (conflict != NO_REASON)
+    {
+      solver->stats.backtracks++;
+      conflicts++;
+      if (s->levels == 0)
+        return found;
+
+      int level = analyze(s, conflict);
+      int lbd = learnt_lbd(s);
+      backtrack(s, level);
+      if (s->learnt.size == 1)
+        enqueue(s, s->learnt.data[0], NO_REASON);
+      else
+        enqueue(s, s->learnt.data[0],
+                add_clause(s, s->learnt.data, s->learnt.size,
+                           LEARNT | (lbd << 2)));
+
+      s->increment /= 0.95;
+      continue;
+    }
+
+    if (conflicts >= luby(restarts) * CDCL_RESTART_BASE)
+    {
+      conflicts = 0;
+      restarts++;
+      backtrack(s, 0);
+      continue;
+    }
+
+    if (s->learnts >= reduce_limit)
+    {
+      reduce(s);
+      reduce_limit += CDCL_REDUCE_INCREMENT;
+    }
+
+    int var = pick_variable(s);
+    if (var < 0)
+    {
+      memcpy(grid->lines, s->lines, s->size * sizeof(binline));
+      memcpy(grid->columns, s->columns, s->size * sizeof(binline));
+      grid_recount(grid);
+      print_solution(solver, grid);
+      solver->stats.solved = true;
+      found = true;
+
+      if (!solver->mode || !block_solution(s))
+        return found;
+      continue;
+    }
+
+    if (solver->max_nodes && solver->stats.nodes >= solver->max_nodes)
+      return found;
+    solver->stats.nodes++;
+
+    new_level(s);
+    enqueue(s, lit_of(var, s->phase[var]), NO_REASON);
+  }
+}
+
+bool cdcl_solver(t_solver *solver, t_grid *grid)
+{
+  /* With MODE_ALL `grid` gets its clues back, like with trail_solver. */
+  binline lines[MAX_GRID_SIZE];
+  binline columns[MAX_GRID_SIZE];
+  memcpy(lines, grid->lines, grid->size * sizeof(binline));
+  memcpy(columns, grid->columns, grid->size * sizeof(binline));
+
+  t_cdcl s;
+  bool result = cdcl_init(&s, grid);
+  if (result && solver->hint)
+  {
+    /* The saved phases start on the hint : a solution close to it comes
+     * first. */
+    for (int var = 0; var < s.vars; var++)
+      s.phase[var] = bits_test(solver->hint->lines[var / s.size][1],
+                               var % s.size);
+  }
+  result = result && cdcl_search(&s, solver, grid);
+  cdcl_free(&s);
+
+  if (solver->mode)
+  {
+    memcpy(grid->lines, lines, grid->size * sizeof(binline));
+    memcpy(grid->columns, columns, grid->size * sizeof(binline));
+    grid_recount(grid);
+  }
+
+  return result;
+}
@@ -0,0 +1,350 @@
+#include "count.h"
+
+#include <string.h>
+
+#include <lines.h>
+
+/* Memoized count of the completions of the rows left after a key, the key
+ * is known by two independent hashes : 128 bits make a wrong hit far less
+ * likely than a memory error. */
+typedef struct
+{
+  uint64_t hash;
+  uint64_t check; /* Never 0, except for a free slot. */
+  uint64_t count;
+} t_memo;
+
+typedef struct
+{
+  int size;
+  int half;
+  uint64_t full_line;
+  uint64_t clues[COUNT_MAX_SIZE][2]; /* Zeros and ones of each row. */
+
+  /* Clue ones and zeros of each column in the rows from r to the last. */
+  uint8_t ones_below[COUNT_MAX_SIZE + 1][COUNT_MAX_SIZE];
+  uint8_t zeros_below[COUNT_MAX_SIZE + 1][COUNT_MAX_SIZE];
+
+  uint64_t rows[COUNT_MAX_SIZE]; /* Ones of the rows placed. */
+  uint8_t ones[COUNT_MAX_SIZE];  /* Ones of each column in these rows. */
+  binline columns[COUNT_MAX_SIZE]; /* Rows placed and clues below. */
+
+  /* classes[r][c] : class of column c among the columns with the same
+   * prefix on the first r rows, numbered in order of first column. */
+  uint8_t classes[COUNT_MAX_SIZE + 1][COUNT_MAX_SIZE];
+  int class_count[COUNT_MAX_SIZE + 1];
+
+  /* binomial[m][k] : ways to put k ones in m cells. */
+  uint64_t binomial[COUNT_MAX_SIZE + 1][COUNT_MAX_SIZE + 1];
+
+  /* Cells of row r which must be 0 and 1. */
+  uint64_t must[COUNT_MAX_SIZE][2];
+
+  t_memo *memo;
+  uint64_t key[3 + 2 * (COUNT_MAX_SIZE / 8) + COUNT_MAX_SIZE];
+
+  t_stats *stats;
+} t_counter;
+
+/* ------------------------ MEMO ------------------------ */
+
+/* Canonical key of the state after r rows : r, the last two rows, the
+ * ones and classes of the columns packed by 8 and the sorted used rows
+ * which the rows left can still repeat. Returns its number of words. */
+static int make_key(t_counter *c, int r)
+{
+  uint64_t *key = c->key;
+  int words = 0;
+
+  key[words++] = r;
+  key[words++] = (r >= 1) ? c->rows[r - 1] : 0;
+  key[words++] = (r >= 2) ? c->rows[r - 2] : 0;
+
+  for (int j = 0; j < c->size; j += 8)
+  {
+    uint64_t ones = 0;
+    uint64_t classes = 0;
+    for (int k = j; k < j + 8 && k < c->size; k++)
+    {
+      ones |= (uint64_t)c->ones[k] << (8 * (k - j));
+      classes |= (uint64_t)c->classes[r][k] << (8 * (k - j));
+    }
+    key[words++] = ones;
+    key[words++] = classes;
+  }
+
+  /* Columns which have all their ones or zeros : the cells left there are
+   * 0, or 1, the used rows with the other value can't come back. Neither
+   * can the rows which don't fit the clues of any row left. */
+  uint64_t no_ones = 0;
+  uint64_t no_zeros = 0;
+  for (int j = 0; j < c->size; j++)
+  {
+    if (c->ones[j] == c->half)
+      no_ones |= word_singleton(j);
+    if (r - c->ones[j] == c->half)
+      no_zeros |= word_singleton(j);
+  }
+
+  /* Insertion sort, there are at most COUNT_MAX_SIZE rows. */
+  uint64_t *used = &key[words];
+  int count = 0;
+  for (int i = 0; i < r; i++)
+  {
+    if ((c->rows[i] & no_ones) || (~c->rows[i] & no_zeros & c->full_line))
+      continue;
+
+    bool fits = false;
+    for (int k = r; k < c->size && !fits; k++)
+      fits = !(c->rows[i] & c->clues[k][0]) && !(~c->rows[i] & c->clues[k][1]);
+    if (!fits)
+      continue;
+
+    int k = count++;
+    while (k > 0 && used[k - 1] > c->rows[i])
+    {
+      used[k] = used[k - 1];
+      k--;
+    }
+    used[k] = c->rows[i];
+  }
+
+  return words + count;
+}
+
+static uint64_t hash_key(const uint64_t *key, int words, uint64_t seed)
+{
+  uint64_t hash = seed;
+  for (int k = 0; k < words; k++)
+  {
+    hash = (hash ^ key[k]) * 0x9E3779B97F4A7C15;
+    hash ^= hash >> 29;
+  }
+
+  return hash;
+}
+
+/* Buckets of 2 slots : the most recent key first. Returns the slot of the
+ * key, or NULL. */
+static t_memo *memo_find(t_counter *c, uint64_t hash, uint64_t check)
+{
+  t_memo *bucket = &c->memo[hash & (COUNT_MEMO_SIZE - 2)];
+  for (int k = 0; k < 2; k++)
+  {
+    if (bucket[k].hash == hash && bucket[k].check == check)
+      return &bucket[k];
+  }
+
+  return NULL;
+}
+
+/* The oldest key of the bucket is forgotten. */
+static void memo_insert(t_counter *c, uint64_t hash, uint64_t check,
+                        uint64_t count)
+{
+  t_memo *bucket = &c->memo[hash & (COUNT_MEMO_SIZE - 2)];
+  bucket[1] = bucket[0];
+  bucket[0] = (t_memo){hash, check, count};
+}
+
+/* ------------------------ ROWS ------------------------ */
+
+static uint64_t count_rows(t_counter *c, int r);
+
+/* Puts `row` at index r and counts the completions of the rows after. */
+static uint64_t place_row(t_counter *c, int r, uint64_t row)
+{
+  for (int i = 0; i < r; i++)
+  {
+    if (c->rows[i] == row)
+      return 0;
+  }
+
+  c->rows[r] = row;
+  c->stats->nodes++;
+
+  /* Splits the classes of columns on the bit of the new row, then numbers
+   * them again in order of first column. */
+  uint8_t map[2 * COUNT_MAX_SIZE];
+  memset(map, 0xFF, sizeof(map));
+  uint8_t next = 0;
+  int members[COUNT_MAX_SIZE] = {0};
+  for (int j = 0; j < c->size; j++)
+  {
+    int split = 2 * c->classes[r][j] + word_bit(row, j);
+    if (map[split] == 0xFF)
+      map[split] = next++;
+    c->classes[r + 1][j] = map[split];
+    c->ones[j] += word_bit(row, j);
+    c->columns[j][word_bit(row, j)].w[0] |= word_singleton(r);
+    members[map[split]]++;
+  }
+  c->class_count[r + 1] = next;
+
+  /* The columns of a class have the same ones, they need as many in the
+   * rows left : a class bigger than the number of such suffixes can't
+   * have distinct columns. */
+  uint64_t count = 0;
+  int left = c->size - (r + 1);
+  bool feasible = true;
+  for (int j = 0; j < c->size && feasible; j++)
+  {
+    int need = c->half - c->ones[j];
+    if (need < 0 || need > left ||
+        (uint64_t)members[c->classes[r + 1][j]] > c->binomial[left][need])
+      feasible = false;
+  }
+
+  /* Each column must still have a legal completion. */
+  for (int j = 0; j < c->size && feasible; j++)
+    feasible = line_completions(c->columns[j], c->size) > 0;
+
+  if (feasible)
+    count = count_rows(c, r + 1);
+
+  for (int j = 0; j < c->size; j++)
+  {
+    c->ones[j] -= word_bit(row, j);
+    /* Clues stay in the columns. */
+    int b = word_bit(row, j);
+    c->columns[j][b].w[0] &=
+        ~word_singleton(r) | (word_bit(c->clues[r][b], j) << r);
+  }
+
+  return count;
+}
+
+/* Completes row r from cell j, `row` holding the ones of the cells before
+ * j : balanced, no three in a row and the cells of `must`. */
+static uint64_t fill_row(t_counter *c, int r, int j, uint64_t row, int ones)
+{
+  if (j == c->size)
+    return place_row(c, r, row);
+
+  uint64_t count = 0;
+  for (int b = 0; b < 2; b++)
+  {
+    if (c->must[r][!b] & word_singleton(j))
+      continue;
+    if ((b ? ones : j - ones) == c->half)
+      continue;
+    if (j >= 2 && word_bit(row, j - 1) == (uint64_t)b &&
+        word_bit(row, j - 2) == (uint64_t)b)
+      continue;
+
+    count += fill_row(c, r, j + 1, row | ((uint64_t)b << j), ones + b);
+  }
+
+  return count;
+}
+
+/* Cells of row r which must be 0 or 1 : clues, three in a column and
+ * columns which already have all their ones or zeros, clues below
+ * included. Returns false if a cell must be both. */
+static bool row_constraints(t_counter *c, int r)
+{
+  uint64_t *must = c->must[r];
+  must[0] = c->clues[r][0];
+  must[1] = c->clues[r][1];
+
+  if (r >= 2)
+  {
+    must[0] |= c->rows[r - 1] & c->rows[r - 2];
+    must[1] |= ~(c->rows[r - 1] | c->rows[r - 2]) & c->full_line;
+  }
+
+  for (int j = 0; j < c->size; j++)
+  {
+    if (c->ones[j] + c->ones_below[r + 1][j] >= c->half)
+      must[0] |= word_singleton(j);
+    if (r - c->ones[j] + c->zeros_below[r + 1][j] >= c->half)
+      must[1] |= word_singleton(j);
+  }
+
+  return (must[0] & must[1]) == 0;
+}
+
+static uint64_t count_rows(t_counter *c, int r)
+{
+  if (r == c->size)
+  {
+    /* Columns are distinct when each one has its own class. */
+    return c->class_count[r] == c->size;
+  }
+
+  int words = make_key(c, r);
+  uint64_t hash = hash_key(c->key, words, 0);
+  uint64_t check = hash_key(c->key, words, 0xC2B2AE3D27D4EB4F) | 1;
+  t_memo *entry = memo_find(c, hash, check);
+  if (entry)
+  {
+    c->stats->memo_hits++;
+    return entry->count;
+  }
+
+  uint64_t count = row_constraints(c, r) ? fill_row(c, r, 0, 0, 0) : 0;
+  memo_insert(c, hash, check, count);
+
+  return count;
+}
+
+/* ------------------------ COUNT ------------------------ */
+
+uint64_t count_solutions(t_grid *grid, t_stats *stats)
+{
+  /* The heuristics only fill forced cells, they keep the count. */
+  t_grid work;
+  grid_copy(grid, &work);
+  if (!grid_heuristics(&work))
+  {
+    return 0;
+  }
+
+  t_counter *c = calloc(1, sizeof(t_counter));
+  if (c == NULL)
+    errx(EXIT_FAILURE, "error: count calloc");
+  c->memo = calloc(COUNT_MEMO_SIZE, sizeof(t_memo));
+  if (c->memo == NULL)
+    errx(EXIT_FAILURE, "error: count calloc");
+
+  c->size = grid->size;
+  c->half = grid->size / 2;
+  c->full_line = word_full(grid->size);
+  c->stats = stats;
+  for (int r = 0; r < c->size; r++)
+  {
+    c->clues[r][0] = work.lines[r][0].w[0];
+    c->clues[r][1] = work.lines[r][1].w[0];
+  }
+
+  for (int m = 0; m <= c->size; m++)
+  {
+    c->binomial[m][0] = 1;
+    for (int k = 1; k <= m; k++)
+      c->binomial[m][k] = c->binomial[m - 1][k - 1] +
+                          ((k < m) ? c->binomial[m - 1][k] : 0);
+  }
+
+  for (int r = c->size - 1; r >= 0; r--)
+  {
+    for (int j = 0; j < c->size; j++)
+    {
+      c->columns[j][0].w[0] |= word_bit(c->clues[r][0], j) << r;
+      c->columns[j][1].w[0] |= word_bit(c->clues[r][1], j) << r;
+      c->ones_below[r][j] =
+          c->ones_below[r + 1][j] + word_bit(c->clues[r][1], j);
+      c->zeros_below[r][j] =
+          c->zeros_below[r + 1][j] + word_bit(c->clues[r][0], j);
+    }
+  }
+
+  uint64_t count = count_rows(c, 0);
+
+  stats->solutions += count;
+  stats->solved = (count > 0);
+
+  free(c->memo);
+  free(c);
+
+  return count;
+}
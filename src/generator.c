@@ -0,0 +1,646 @@
+#include "generator.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <err.h>
+#include <pthread.h>
+
+#include <cdcl.h>
+
+const char *difficulty_names[DIFFICULTY_COUNT] = {"none", "easy", "medium",
+                                                  "hard", "expert"};
+
+difficulty_t difficulty_from_name(const char *name)
+{
+  for (int level = DIFFICULTY_EASY; level < DIFFICULTY_COUNT; level++)
+  {
+    if (strcmp(name, difficulty_names[level]) == 0)
+      return level;
+  }
+
+  return DIFFICULTY_COUNT;
+}
+
+/* Last rule a puzzle of each difficulty may need, RULE_COUNT for a
+ * search. */
+static const rule_id difficulty_rules[DIFFICULTY_COUNT] = {
+    RULE_COUNT, RULE_INBETWEEN, RULE_HALF_LINE, RULE_WHOLE_LINE, RULE_COUNT};
+
+/* ------------------------ RANDOM ------------------------ */
+
+static inline uint64_t mix(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+  return x ^ (x >> 31);
+}
+
+void rng_seed(t_rng *rng, uint64_t seed, uint64_t stream)
+{
+  rng->state = mix(seed) ^ mix(stream + 0x9E3779B97F4A7C15);
+}
+
+uint64_t rng_next(t_rng *rng)
+{
+  rng->state += 0x9E3779B97F4A7C15;
+  return mix(rng->state);
+}
+
+int rng_below(t_rng *rng, int bound)
+{
+  return (int)(((rng_next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+uint64_t rng_entropy(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return mix(((uint64_t)ts.tv_sec << 30) ^ (uint64_t)ts.tv_nsec) ^
+         mix((uint64_t)getpid());
+}
+
+/* ------------------------ GRIDS ------------------------ */
+
+difficulty_t puzzle_difficulty(const t_grid *puzzle, t_grid *work)
+{
+  grid_copy(puzzle, work);
+
+  rule_id hardest = grid_hardest_rule(work);
+  for (int level = DIFFICULTY_EASY; level < DIFFICULTY_EXPERT; level++)
+  {
+    if (hardest <= difficulty_rules[level])
+      return level;
+  }
+
+  return DIFFICULTY_EXPERT;
+}
+
+/* Draws random cells of `grid` and gives each a random value, the
+ * heuristics propagating it. A value which makes the grid inconsistent is
+ * swapped for the other one. Stops once 1/GEN_SEED_RATIO of the grid is
+ * filled. Returns false if both values of a cell are inconsistent. */
+static bool grid_seed(t_grid *grid, t_grid *backup, t_rng *rng)
+{
+  int square_size = grid->size * grid->size;
+  int filled = 0;
+
+  while (filled * GEN_SEED_RATIO < square_size)
+  {
+    int cell = rng_below(rng, square_size);
+    int row = cell / grid->size;
+    int column = cell % grid->size;
+    if (get_cell(row, column, grid) != EMPTY_CELL)
+      continue;
+
+    char value = rng_below(rng, 2) + ZERO;
+    grid_copy(grid, backup);
+    set_cell(row, column, grid, value);
+    if (!grid_heuristics(grid))
+    {
+      grid_copy(backup, grid);
+      set_cell(row, column, grid, (value == ONE) ? ZERO : ONE);
+      if (!grid_heuristics(grid))
+        return false;
+    }
+
+    filled = 0;
+    for (int i = 0; i < grid->size; i++)
+      filled += grid->counts[LINE][i][0] + grid->counts[LINE][i][1];
+  }
+
+  return true;
+}
+
+/* Random cells are seeded with propagation, then the trail solver
+ * completes the grid within GEN_MAX_NODES nodes, branching on the value
+ * each line needs most. The construction restarts from an empty grid when
+ * the seeds lead to a dead end, which keeps the time of generation
+ * bounded. */
+t_grid *grid_generate(int size, t_rng *rng)
+{
+  t_grid *grid = grid_new(size);
+  if (!grid)
+    errx(EXIT_FAILURE, "error: grid_generate malloc");
+
+  t_grid backup;
+
+  t_solver solver;
+  if (!solver_init(&solver, grid, NULL, MODE_FIRST, false))
+    errx(EXIT_FAILURE, "error: can't initialize the solver");
+  /* Beyond 64 the descent alone needs more nodes, as many more as cells. */
+  solver.max_nodes = GEN_MAX_NODES;
+  if (size > 64)
+    solver.max_nodes *= (size / 64) * (size / 64);
+  solver.branching = BRANCH_BALANCE;
+
+  while (true)
+  {
+    grid_init(grid, size);
+    solver.stats.nodes = 0;
+    if (grid_seed(grid, &backup, rng) && trail_solver(&solver, grid))
+      break;
+  }
+
+  solver_free(&solver);
+
+  return grid;
+}
+
+/* Fills `index_tab` with the cells of the grid in a random order. */
+static void shuffle_cells(int *index_tab, int square_size, t_rng *rng)
+{
+  for (int i = 0; i < square_size; i++)
+    index_tab[i] = i;
+
+  int j, temp;
+  for (int i = 0; i < square_size; i++)
+  {
+    j = i + rng_below(rng, square_size - i);
+    temp = index_tab[i];
+    index_tab[i] = index_tab[j];
+    index_tab[j] = temp;
+  }
+}
+
+bool grid_remove_cells(t_grid *grid, bool unique, t_rng *rng)
+{
+  /* Tab of randomized indexes of the grid */
+  int square_size = grid->size * grid->size;
+  int index_tab[square_size];
+  shuffle_cells(index_tab, square_size, rng);
+
+  if (unique)
+  {
+    int nb_to_remove = square_size - (int)(N * square_size);
+    int i = 0;
+    int nb_removed = 0;
+
+    /* The grid is the unique solution of each puzzle along the way : a
+     * cell can go if the puzzle without it has no solution with the other
+     * value there. The solver and its grid serve every removal. */
+    t_grid work;
+    grid_init(&work, grid->size);
+    t_solver solver;
+    if (!solver_init(&solver, &work, NULL, MODE_FIRST, false))
+      errx(EXIT_FAILURE, "error: can't initialize the solver");
+    solver.max_nodes = GEN_REFUTE_NODES;
+
+    while ((nb_removed < nb_to_remove) && (i < square_size))
+    {
+      int row = index_tab[i] / grid->size;
+      int column = index_tab[i] % grid->size;
+      char value = get_cell(row, column, grid);
+      i++;
+
+      if (value == EMPTY_CELL)
+        continue;
+
+      set_cell(row, column, grid, EMPTY_CELL);
+      /* A flip the budget can't refute is kept as if it had a solution. */
+      if (refute_cell(&solver, &work, grid, row, column, value) !=
+          REFUTE_REFUTED)
+      {
+        /* The cell is needed to keep the solution unique. */
+        set_cell(row, column, grid, value);
+        continue;
+      }
+      nb_removed++;
+    }
+
+    solver_free(&solver);
+
+    return (i < square_size);
+  }
+  /* Not unique generation. */
+  else
+  {
+    int nb_to_remove = square_size - (int)(N * square_size);
+    for (int i = 0; i < nb_to_remove; i++)
+    {
+      set_cell(index_tab[i] / grid->size, index_tab[i] % grid->size,
+               grid, EMPTY_CELL);
+    }
+
+    return true;
+  }
+}
+
+bool grid_remove_to_difficulty(t_grid *grid, difficulty_t target,
+                               t_rng *rng)
+{
+  int square_size = grid->size * grid->size;
+  int index_tab[square_size];
+  shuffle_cells(index_tab, square_size, rng);
+
+  t_grid work;
+  grid_init(&work, grid->size);
+  t_solver solver;
+  if (!solver_init(&solver, &work, NULL, MODE_FIRST, false))
+    errx(EXIT_FAILURE, "error: can't initialize the solver");
+  solver.max_nodes = GEN_REFUTE_NODES;
+
+  for (int i = 0; i < square_size; i++)
+  {
+    int row = index_tab[i] / grid->size;
+    int column = index_tab[i] % grid->size;
+    char value = get_cell(row, column, grid);
+    if (value == EMPTY_CELL)
+      continue;
+
+    set_cell(row, column, grid, EMPTY_CELL);
+
+    /* Below the search, the rules of the target filling the grid rate the
+     * puzzle and prove its solution unique at once. */
+    bool removable;
+    if (target < DIFFICULTY_EXPERT)
+    {
+      grid_copy(grid, &work);
+      removable = grid_heuristics_limited(&work, difficulty_rules[target]) &&
+             is_full(&work);
+    }
+    else
+    {
+      removable = (refute_cell(&solver, &work, grid, row, column, value) ==
+                   REFUTE_REFUTED);
+    }
+
+    if (!removable)
+      set_cell(row, column, grid, value);
+  }
+
+  bool hit = (puzzle_difficulty(grid, &work) == target);
+
+  solver_free(&solver);
+
+  return hit;
+}
+
+/* ------------------------ MINIMIZATION ------------------------ */
+
+static double now(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Grids and solver of a thread of the minimization, kept from a batch to
+ * the next. */
+typedef struct
+{
+  t_grid puzzle;
+  t_grid work;
+  t_solver solver;
+  struct s_checks *checks;
+  pthread_t thread;
+} t_checker;
+
+typedef enum
+{
+  CLUE_NEEDED,
+  CLUE_REDUNDANT,
+  CLUE_UNDECIDED
+} verdict_t;
+
+/* Clues of a batch to check on `base`. */
+typedef struct s_checks
+{
+  const t_grid *base;
+  const int *cells;
+  const char *values; /* Value of each cell in the solution. */
+  verdict_t *verdicts;
+  int count;
+  atomic_int next;
+} t_checks;
+
+/* Looks for a solution of `base` without the clue (row, column) with the
+ * other value there. A flip the trail search can't refute within
+ * GEN_REFUTE_NODES nodes goes to the CDCL engine, its phases on the
+ * solution of the puzzle : the other solutions are often close to it. */
+static verdict_t clue_check(t_checker *checker, const t_grid *base, int row,
+                            int column, char value)
+{
+  grid_copy(base, &checker->puzzle);
+  set_cell(row, column, &checker->puzzle, EMPTY_CELL);
+
+  t_solver *solver = &checker->solver;
+  solver->max_nodes = GEN_REFUTE_NODES;
+  refute_t result = refute_cell(solver, &checker->work, &checker->puzzle, row,
+                                column, value);
+  if (result == REFUTE_REFUTED)
+    return CLUE_REDUNDANT;
+  if (result == REFUTE_SOLVED)
+    return CLUE_NEEDED;
+
+  grid_copy(&checker->puzzle, &checker->work);
+  set_cell(row, column, &checker->work, (value == ONE) ? ZERO : ONE);
+
+  size_t nodes = solver->stats.nodes;
+  solver->stats.nodes = 0;
+  solver->max_nodes = GEN_MINIMIZE_NODES;
+  verdict_t verdict = CLUE_NEEDED;
+  if (!cdcl_solver(solver, &checker->work))
+    verdict = (solver->stats.nodes < GEN_MINIMIZE_NODES) ? CLUE_REDUNDANT
+                                                          : CLUE_UNDECIDED;
+  solver->stats.nodes += nodes;
+
+  return verdict;
+}
+
+static void *checker_run(void *arg)
+{
+  t_checker *checker = arg;
+  t_checks *checks = checker->checks;
+
+  while (true)
+  {
+    int i = atomic_fetch_add(&checks->next, 1);
+    if (i >= checks->count)
+      break;
+
+    int size = checks->base->size;
+    checks->verdicts[i] =
+        clue_check(checker, checks->base, checks->cells[i] / size,
+                   checks->cells[i] % size, checks->values[i]);
+  }
+
+  return NULL;
+}
+
+/* Checks the `count` clues of `cells` on `base` with the checkers. */
+static void run_checks(t_checker *checkers, int threads, const t_grid *base,
+                       const int *cells, const char *values,
+                       verdict_t *verdicts, int count)
+{
+  t_checks checks = {.base = base, .cells = cells, .values = values,
+                     .verdicts = verdicts, .count = count};
+  atomic_init(&checks.next, 0);
+
+  int started = 0;
+  for (int i = 0; i < threads && i < count; i++)
+  {
+    checkers[i].checks = &checks;
+    if (i > 0 &&
+        pthread_create(&checkers[i].thread, NULL, checker_run, &checkers[i]))
+      break;
+    started++;
+  }
+
+  /* The first checker is the calling thread. */
+  checker_run(&checkers[0]);
+
+  for (int i = 1; i < started; i++)
+    pthread_join(checkers[i].thread, NULL);
+}
+
+void puzzle_minimize(t_grid *puzzle, int threads, t_rng *rng,
+                     t_gen_stats *stats)
+{
+  double start = now();
+  int size = puzzle->size;
+  int square_size = size * size;
+
+  /* Clues left to check, in a random order : a ring, a clue is in it at
+   * most once. */
+  int queue[square_size];
+  shuffle_cells(queue, square_size, rng);
+  int head = 0;
+  int tail = 0;
+  for (int i = 0; i < square_size; i++)
+  {
+    if (get_cell(queue[i] / size, queue[i] % size, puzzle) != EMPTY_CELL)
+      queue[tail++] = queue[i];
+  }
+
+  /* The grids of the checkers start on cache lines. */
+  t_checker *checkers =
+      aligned_alloc(GRID_ALIGNMENT, threads * sizeof(t_checker));
+  if (checkers == NULL)
+    errx(EXIT_FAILURE, "error: checkers aligned_alloc");
+  for (int i = 0; i < threads; i++)
+  {
+    grid_init(&checkers[i].puzzle, size);
+    grid_init(&checkers[i].work, size);
+    if (!solver_init(&checkers[i].solver, &checkers[i].work, NULL,
+                     MODE_FIRST, false))
+      errx(EXIT_FAILURE, "error: can't initialize the solver");
+  }
+
+  t_grid solution;
+  grid_copy(puzzle, &solution);
+  if (!cdcl_solver(&checkers[0].solver, &solution))
+    errx(EXIT_FAILURE, "error: the puzzle to minimize has no solution");
+  for (int i = 0; i < threads; i++)
+    checkers[i].solver.hint = &solution;
+
+  int capacity = threads * GEN_MINIMIZE_BATCH;
+  int cells[capacity];
+  char values[capacity];
+  verdict_t verdicts[capacity];
+  t_grid base;
+  grid_init(&base, size);
+  stats->removed = 0;
+  stats->undecided = 0;
+
+  while (head < tail)
+  {
+    int count = 0;
+    while (count < capacity && head < tail)
+    {
+      cells[count] = queue[head++ % square_size];
+      values[count] = get_cell(cells[count] / size, cells[count] % size,
+                               puzzle);
+      count++;
+    }
+
+    /* A clue the puzzle can't do without is needed by every puzzle with
+     * fewer clues : it stays for good. */
+    run_checks(checkers, threads, puzzle, cells, values, verdicts, count);
+    int found = 0;
+    for (int i = 0; i < count; i++)
+    {
+      stats->undecided += (verdicts[i] == CLUE_UNDECIDED);
+      if (verdicts[i] == CLUE_REDUNDANT)
+      {
+        cells[found] = cells[i];
+        values[found] = values[i];
+        found++;
+      }
+    }
+    if (found == 0)
+      continue;
+
+    /* Clues redundant one at a time may not be redundant together. A
+     * second solution without all of them differs from the solution on
+     * one of them at least : it is enough to check each of them again on
+     * the puzzle without all of them. */
+    grid_copy(puzzle, &base);
+    for (int i = 0; i < found; i++)
+      set_cell(cells[i] / size, cells[i] % size, &base, EMPTY_CELL);
+
+    bool together = true;
+    if (found > 1)
+    {
+      run_checks(checkers, threads, &base, cells, values, verdicts, found);
+      for (int i = 0; i < found; i++)
+        together = together && (verdicts[i] == CLUE_REDUNDANT);
+    }
+
+    if (together)
+    {
+      grid_copy(&base, puzzle);
+      stats->removed += found;
+      continue;
+    }
+
+    /* Only the first clue goes, the others are checked again later. */
+    set_cell(cells[0] / size, cells[0] % size, puzzle, EMPTY_CELL);
+    stats->removed++;
+    for (int i = 1; i < found; i++)
+      queue[tail++ % square_size] = cells[i];
+  }
+
+  for (int i = 0; i < threads; i++)
+  {
+    solver_free(&checkers[i].solver);
+  }
+  free(checkers);
+
+  stats->time = now() - start;
+}
+
+/* ------------------------ PUZZLES ------------------------ */
+
+static t_grid *puzzle_remove(const t_gen_config *config, t_rng *rng)
+{
+  if (config->difficulty != DIFFICULTY_NONE)
+  {
+    for (int tries = 0; tries < GEN_DIFFICULTY_TRIES; tries++)
+    {
+      t_grid *grid = grid_generate(config->size, rng);
+      if (grid_remove_to_difficulty(grid, config->difficulty, rng))
+        return grid;
+
+      free(grid);
+    }
+
+    return NULL;
+  }
+
+  while (true)
+  {
+    t_grid *grid = grid_generate(config->size, rng);
+    if (config->size == MIN_GRID_SIZE)
+      return grid;
+
+    for (int i = 0; i < MAX_ASSEMBLE_LOOP; i++)
+    {
+      if (grid_remove_cells(grid, config->unique, rng))
+        return grid;
+    }
+
+    free(grid);
+  }
+}
+
+t_grid *puzzle_generate(const t_gen_config *config, uint64_t stream,
+                        t_gen_stats *stats)
+{
+  t_rng rng;
+  rng_seed(&rng, config->seed, stream);
+
+  *stats = (t_gen_stats){0};
+  t_grid *grid = puzzle_remove(config, &rng);
+  if (grid && config->minimize)
+    puzzle_minimize(grid, config->threads, &rng, stats);
+
+  return grid;
+}
+
+/* ------------------------ BATCH ------------------------ */
+
+typedef struct
+{
+  t_gen_config config; /* A single thread minimizes each puzzle. */
+  size_t count;
+  FILE *fd;
+  atomic_size_t next; /* Number of the next puzzle to generate. */
+  pthread_mutex_t lock; /* Puzzles are printed one at a time. */
+} t_batch;
+
+static void *batch_run(void *arg)
+{
+  t_batch *batch = arg;
+
+  while (true)
+  {
+    size_t k = atomic_fetch_add(&batch->next, 1);
+    if (k >= batch->count)
+      break;
+
+    t_gen_stats stats;
+    t_grid *grid = puzzle_generate(&batch->config, k, &stats);
+
+    pthread_mutex_lock(&batch->lock);
+    if (grid == NULL)
+    {
+      fprintf(batch->fd, "# puzzle %zu : no %s grid found\n\n", k,
+              difficulty_names[batch->config.difficulty]);
+    }
+    else if (batch->config.minimize)
+    {
+      fprintf(batch->fd, "# puzzle %zu : %d clues removed by the "
+                         "minimization in %f seconds, %d undecided\n",
+              k, stats.removed, stats.time, stats.undecided);
+      grid_print(grid, batch->fd);
+    }
+    else
+    {
+      fprintf(batch->fd, "# puzzle %zu\n", k);
+      grid_print(grid, batch->fd);
+    }
+    fflush(batch->fd);
+    pthread_mutex_unlock(&batch->lock);
+
+    free(grid);
+  }
+
+  return NULL;
+}
+
+bool generate_batch(const t_gen_config *config, size_t count, int threads,
+                    FILE *fd)
+{
+  t_batch batch = {.config = *config, .count = count, .fd = fd};
+  batch.config.threads = 1;
+  atomic_init(&batch.next, 0);
+  pthread_mutex_init(&batch.lock, NULL);
+
+  pthread_t *workers = calloc(threads, sizeof(pthread_t));
+  if (workers == NULL)
+  {
+    warnx("error: workers calloc");
+    pthread_mutex_destroy(&batch.lock);
+    return false;
+  }
+
+  int started = 0;
+  while (started < threads &&
+         pthread_create(&workers[started], NULL, batch_run, &batch) == 0)
+    started++;
+
+  /* The workers started generate every puzzle between them. */
+  if (started == 0)
+    batch_run(&batch);
+
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+
+  free(workers);
+  pthread_mutex_destroy(&batch.lock);
+
+  return true;
+}
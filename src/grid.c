@@ -1,22 +1,43 @@
 #include "grid.h"
 
 #include <inttypes.h>
+#include <stdatomic.h>
+#include <string.h>
 
-/* ------------------------ MACROS ------------------------ */
-#define singleton(i) ((uint64_t)1 << (i))
-
-#define too_many(c, axis) (gridline_count(axis[k][c]) > grid->size / 2)
-#define line_is_full(k, axis) ((axis[k][1] ^ axis[k][0]) == full_line)
-#define identical(axis, k, l) (((axis[k][1] ^ axis[l][1]) == 0) && ((axis[k][0] ^ axis[l][0]) == 0))
+#include <lines.h>
 
-#define three_in_a_row_on_a_line(c) ((grid->lines[i][c] & (grid->lines[i][c] >> 1) & (grid->lines[i][c] >> 2)) != 0)
-#define three_in_a_row_on_a_column(c) ((grid->columns[i][c] & (grid->columns[i][c] >> 1) & (grid->columns[i][c] >> 2)) != 0)
+/* ------------------------ MACROS ------------------------ */
+#define too_many(c, mode) (grid->counts[mode][k][c] > grid->size / 2)
+#define line_is_full(k, axis)                                                 \
+  (bits_equal(bits_xor(axis[k][1], axis[k][0]), full_line))
+#define identical(a, b) (bits_equal((a)[1], (b)[1]) && bits_equal((a)[0], (b)[0]))
+
+#define three_in_a_row(line)                                                  \
+  (bits_any(                                                                  \
+      bits_and(bits_and((line), bits_shr((line), 1)), bits_shr((line), 2))))
+#define three_in_a_row_on_a_line(c) three_in_a_row(grid->lines[i][c])
+#define three_in_a_row_on_a_column(c) three_in_a_row(grid->columns[i][c])
+
+/* Functions of the propagation kernels, inlined in each of them so that
+ * their size is a constant (see PROPAGATE_KERNEL). */
+#if defined(__GNUC__)
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE inline
+#endif
 
 /* returns grid->axis[i].type, type being ones or zeros */
-#define is_empty(i, j) (((grid->lines[i][1] & singleton(j)) == 0) & ((grid->lines[i][0] & singleton(j)) == 0))
+#define is_empty(i, j) (!bits_test(grid->lines[i][1], j) && !bits_test(grid->lines[i][0], j))
 
 /* -------------------------------------------------------- */
 
+/* Number of grids made by grid_new, the workers of the generator make
+ * theirs concurrently. */
+static atomic_size_t allocations = 0;
+
+/* Work of the heuristics run by each thread. */
+static _Thread_local t_rule_stats rule_stats;
+
 bool check_char(const t_grid *g, const char c)
 {
   if (g == NULL)
@@ -27,51 +48,142 @@ bool check_char(const t_grid *g, const char c)
 
 bool check_size(const int size)
 {
-  return (size == 4 || size == 8 || size == 16 || size == 32 || size == 64);
+  return (size >= MIN_GRID_SIZE && size <= MAX_GRID_SIZE &&
+          (size & (size - 1)) == 0);
 }
 
-void grid_allocate(t_grid *grid, int size)
+/* ----------------------- LINE SETS ---------------------- */
+
+static void lineset_clear(t_lineset *set)
 {
-  if (!check_size(size))
+  memset(set->index, -1, sizeof(set->index));
+  memset(set->slot, -1, sizeof(set->slot));
+}
+
+static inline int lineset_home(const t_bits *key)
+{
+  return (int)(bits_hash(key) >> (64 - LINESET_BITS));
+}
+
+#define lineset_next(i) (((i) + 1) & (LINESET_CAPACITY - 1))
+
+/* Removes the entry in slot i, shifting back the following entries of the
+ * cluster so that lookups never need tombstones. */
+static void lineset_erase(t_lineset *set, int i)
+{
+  int j = i;
+  set->slot[set->index[i]] = -1;
+
+  while (true)
   {
-    warnx("error: wrong grid size given");
-    return;
+    j = lineset_next(j);
+    if (set->index[j] < 0)
+      break;
+
+    /* The entry in j can fill the hole in i only if its home slot isn't
+     * cyclically in (i, j]. */
+    int home = lineset_home(set->keys[j]);
+    bool stays = (i <= j) ? ((i < home) && (home <= j))
+                          : ((i < home) || (home <= j));
+    if (stays)
+      continue;
+
+    set->keys[i][0] = set->keys[j][0];
+    set->keys[i][1] = set->keys[j][1];
+    set->index[i] = set->index[j];
+    set->slot[set->index[i]] = i;
+    i = j;
   }
 
-  if (grid == NULL)
+  set->index[i] = -1;
+}
+
+/* Adds the full line k of `axis` to the set. Returns false if another full
+ * line of the axis is identical. */
+static bool lineset_insert(t_lineset *set, binline *axis, int k)
+{
+  int i = lineset_home(axis[k]);
+  bool present = false;
+
+  for (; set->index[i] >= 0; i = lineset_next(i))
   {
-    warnx("error: grid null in grid_allocate");
-    return;
+    int l = set->index[i];
+    if (!identical(set->keys[i], axis[k]))
+      continue;
+
+    /* Only a live entry is a duplicate, line l may have been emptied by a
+     * backtrack since its insertion. */
+    if (l == k)
+      present = true;
+    else if (identical(axis[l], axis[k]))
+      return false;
   }
 
-  grid->size = size;
-  grid->onHeap = 0;
+  if (present)
+    return true;
 
-  grid->lines = calloc(size, sizeof(binline));
-  if (grid->lines == NULL)
+  /* Line k may still have an entry for an older content. */
+  if (set->slot[k] >= 0)
   {
-    warnx("error: lines calloc\n");
+    lineset_erase(set, set->slot[k]);
+    for (i = lineset_home(axis[k]); set->index[i] >= 0; i = lineset_next(i))
+      ;
+  }
+
+  set->keys[i][0] = axis[k][0];
+  set->keys[i][1] = axis[k][1];
+  set->index[i] = k;
+  set->slot[k] = i;
+  return true;
+}
+
+/* -------------------------------------------------------- */
+
+void grid_init(t_grid *grid, int size)
+{
+  if (!check_size(size))
+  {
+    warnx("error: wrong grid size given");
     return;
   }
 
-  grid->columns = calloc(size, sizeof(binline));
-  if (grid->columns == NULL)
+  if (grid == NULL)
   {
-    free(grid->lines);
-    warnx("error: columns calloc\n");
+    warnx("error: grid null in grid_init");
     return;
   }
+
+  grid->size = size;
+  memset(grid->lines, 0, sizeof(grid->lines));
+  memset(grid->columns, 0, sizeof(grid->columns));
+  memset(grid->counts, 0, sizeof(grid->counts));
+  grid->dirty[LINE] = bits_zero();
+  grid->dirty[COLUMN] = bits_zero();
+  grid->queue[LINE] = bits_zero();
+  grid->queue[COLUMN] = bits_zero();
+  lineset_clear(&grid->completed[LINE]);
+  lineset_clear(&grid->completed[COLUMN]);
 }
 
-void grid_free(t_grid *grid)
+t_grid *grid_new(int size)
 {
+  /* sizeof(t_grid) is a multiple of its alignment, as aligned_alloc
+   * wants. */
+  t_grid *grid = aligned_alloc(GRID_ALIGNMENT, sizeof(t_grid));
   if (grid == NULL)
   {
-    return;
+    warnx("error: grid aligned_alloc");
+    return NULL;
   }
 
-  free(grid->lines);
-  free(grid->columns);
+  grid_init(grid, size);
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return grid;
+}
+
+size_t grid_allocations(void)
+{
+  return atomic_load_explicit(&allocations, memory_order_relaxed);
 }
 
 void grid_print(t_grid *grid, FILE *fd)
@@ -80,9 +192,9 @@ void grid_print(t_grid *grid, FILE *fd)
   {
     for (int j = 0; j < grid->size; j++)
     {
-      if ((1 & (grid->lines[i][1] >> j)) == 1)
+      if (bits_test(grid->lines[i][1], j))
         fprintf(fd, "1 ");
-      else if ((1 & (grid->lines[i][0] >> j)) == 1)
+      else if (bits_test(grid->lines[i][0], j))
         fprintf(fd, "0 ");
       else
         fprintf(fd, "_ ");
@@ -92,38 +204,227 @@ void grid_print(t_grid *grid, FILE *fd)
   fprintf(fd, "\n");
 }
 
-void grid_copy(t_grid *grid, t_grid *grid_copy)
+void grid_copy(const t_grid *grid, t_grid *grid_copy)
 {
-  if (grid == NULL)
+  memcpy(grid_copy, grid, sizeof(t_grid));
+}
+
+/* This function fills the grid starting from the 2nd line. */
+static bool fill_grid(t_grid *grid, int size, int *current_ptr,
+                      FILE *parsing_file, int *row, int *col)
+{
+  while (*current_ptr != EOF)
   {
-    printf("grid NULL in grid_copy\n");
-    return;
+    /* Ignore comment line. */
+    if (*current_ptr == '#')
+    {
+      while (!(*current_ptr == '\n' || *current_ptr == EOF))
+      {
+        *current_ptr = fgetc(parsing_file);
+      }
+    }
+
+    /* End of line. */
+    else if (*current_ptr == '\n')
+    {
+      if (*col != 0)
+      {
+        if (*col != size)
+        {
+          warnx("error: wrong number of character at line %d!", *row + 1);
+          return false;
+        }
+        *col = 0;
+        (*row)++;
+      }
+    }
+
+    /* Significant line : fill grid. */
+    else if (*current_ptr != ' ' && *current_ptr != '\t' &&
+             *current_ptr != EOF)
+    {
+      if (!check_char(grid, *current_ptr))
+      {
+        warnx("error: wrong character '%c' at line %d!", *current_ptr,
+              *row + 1);
+        return false;
+      }
+
+      if (*row >= size)
+      {
+        warnx("error: grid has too many lines");
+        return false;
+      }
+      set_cell(*row, *col, grid, *current_ptr);
+      (*col)++;
+    }
+
+    *current_ptr = fgetc(parsing_file);
+  } /* current_char = EOF. */
+
+  return true;
+}
+
+/* Opens the given file and detects when is the grid starting :
+ * ignore comments and empty lines.
+ * Fills the first grid with the first line of the file and checks if the
+ * size of the line is a correct one, if yes fills the rest of the grid and
+ * checks subsiding errors : wrong character, wrong number of characters.. */
+t_grid *file_parser(char *filename)
+{
+  FILE *parsing_file = NULL;
+  t_grid *grid = NULL;
+
+  parsing_file = fopen(filename, "r");
+  if (parsing_file == NULL)
+  {
+    warnx("error : can't open !file %s", filename);
+    goto error;
   }
 
-  if (grid_copy == NULL)
+  int current_char;
+
+  /* Deciding when is starting the first row (not counting comments). */
+  do
   {
-    printf("grid_copy NULL in grid_copy\n");
-    return;
+    current_char = fgetc(parsing_file);
+
+    if (current_char == '#')
+      while (current_char != '\n' && current_char != EOF)
+        current_char = fgetc(parsing_file);
+
+    if (current_char == EOF)
+    {
+      warnx("error: EOF at beginning of the file %s", filename);
+      goto error;
+    }
+
+  } while (current_char == '\t' || current_char == '\n' ||
+           current_char == ' ' || current_char == '#');
+
+  char line[MAX_GRID_SIZE];
+  line[0] = current_char;
+  int size = 1;
+  current_char = fgetc(parsing_file);
+
+  /* Fill `line` with first significant (not comments) line of the file. */
+  while (current_char != EOF && current_char != '\n')
+  {
+    if (current_char != ' ' && current_char != '\t')
+    {
+      if (size == MAX_GRID_SIZE)
+      {
+        warnx("error: first line size in file %s is too long", filename);
+        goto error;
+      }
+      line[size] = current_char;
+      size++;
+    }
+    current_char = fgetc(parsing_file);
+  } /* `current_char` = EOF or '\n'. */
+
+  if (!check_size(size))
+  {
+    warnx("error: wrong line size in file %s", filename);
+    goto error;
   }
 
-  grid_allocate(grid_copy, grid->size);
+  /* The grid is returned to the caller, it can't live on our stack. */
+  grid = grid_new(size);
+  if (grid == NULL)
+    goto error;
 
-  for (int i = 0; i < grid->size; i++)
+  int row = 0;
+  int col;
+
+  /* Initialize first row of grid. */
+  for (col = 0; col < size; col++)
+  {
+    if (!check_char(grid, line[col]))
+    {
+      warnx("error: wrong character '%c' at line 1!", line[col]);
+      goto error;
+    }
+    set_cell(row, col, grid, line[col]);
+  }
+
+  row++;
+  col = 0;
+  current_char = fgetc(parsing_file);
+
+  if (!fill_grid(grid, size, &current_char, parsing_file, &row, &col))
+    goto error;
+
+  /* `current_char` = EOF, check any subsiding error case. */
+
+  if (col != 0) /* EOF found before '\n'. */
+  {
+    if (col != size)
+    {
+      warnx("error: line %d is malformed! (wrong number of cols)",
+            row + 1);
+      goto error;
+    }
+    col = 0;
+    row++;
+  }
+
+  if (row != size)
   {
-    grid_copy->lines[i][0] = grid->lines[i][0];
-    grid_copy->lines[i][1] = grid->lines[i][1];
-    grid_copy->columns[i][0] = grid->columns[i][0];
-    grid_copy->columns[i][1] = grid->columns[i][1];
+    warnx("error: grid has wrong number of lines");
+    goto error;
   }
+
+  fclose(parsing_file);
+  return grid;
+
+/* I justify the use of goto because there are a lot of error possibily
+ * to avoid code redundancy. */
+error:
+
+  free(grid);
+
+  if (parsing_file != NULL)
+    fclose(parsing_file);
+
+  return NULL;
 }
 
 static inline void set_empty(int i, int j, t_grid *grid)
 {
-  grid->lines[i][1] &= ~singleton(j);
-  grid->lines[i][0] &= ~singleton(j);
-  grid->columns[j][1] &= ~singleton(i);
-  grid->columns[j][0] &= ~singleton(i);
-} /* line = line & ~singleton allows removing singleton to the line */
+  for (int type = 0; type < 2; type++)
+  {
+    if (!bits_test(grid->lines[i][type], j))
+      continue;
+
+    bits_reset(&grid->lines[i][type], j);
+    bits_reset(&grid->columns[j][type], i);
+    grid->counts[LINE][i][type]--;
+    grid->counts[COLUMN][j][type]--;
+  }
+}
+
+/* Writes `type` in the cell (i,j) of both axes and counts it. */
+static inline void fill_cell(int i, int j, t_grid *grid, int type)
+{
+  if (bits_test(grid->lines[i][type], j))
+    return;
+
+  bits_set(&grid->lines[i][type], j);
+  bits_set(&grid->columns[j][type], i);
+  grid->counts[LINE][i][type]++;
+  grid->counts[COLUMN][j][type]++;
+}
+
+/* The line i and the column j have changed : they have to be checked and
+ * propagated again. */
+static inline void mark_cell(int i, int j, t_grid *grid)
+{
+  bits_set(&grid->dirty[LINE], i);
+  bits_set(&grid->dirty[COLUMN], j);
+  bits_set(&grid->queue[LINE], i);
+  bits_set(&grid->queue[COLUMN], j);
+}
 
 void set_cell(int i, int j, t_grid *grid, char v)
 {
@@ -132,16 +433,16 @@ void set_cell(int i, int j, t_grid *grid, char v)
     warnx("error: set_cell wrong indexes / NULL grid");
   }
 
+  mark_cell(i, j, grid);
+
   switch (v)
   {
   case ONE:
-    grid->lines[i][1] |= singleton(j);
-    grid->columns[j][1] |= singleton(i);
+    fill_cell(i, j, grid, 1);
     break;
 
   case ZERO:
-    grid->lines[i][0] |= singleton(j);
-    grid->columns[j][0] |= singleton(i);
+    fill_cell(i, j, grid, 0);
     break;
 
   case EMPTY_CELL:
@@ -162,72 +463,120 @@ char get_cell(int i, int j, t_grid *grid)
     return EMPTY_CELL;
   }
 
-  if ((grid->lines[i][1] & singleton(j)) != 0)
+  if (bits_test(grid->lines[i][1], j))
     return ONE;
 
-  if ((grid->lines[i][0] & singleton(j)) != 0)
+  if (bits_test(grid->lines[i][0], j))
     return ZERO;
 
   /* It isn't ONE neither ZERO. */
   return EMPTY_CELL;
 }
 
-int gridline_count(uint64_t gridline)
+int gridline_count(t_bits gridline)
+{
+  return bits_count(gridline);
+}
+
+/* Masks selecting the lower half of each block of 2j bits. */
+static const uint64_t transpose_masks[] = {
+    0x00000000FFFFFFFF, 0x0000FFFF0000FFFF, 0x00FF00FF00FF00FF,
+    0x0F0F0F0F0F0F0F0F, 0x3333333333333333, 0x5555555555555555};
+
+/* Transposes in place the `size` x `size` bit-matrix of `rows`, size <= 64.
+ * Recursive block swap : at each step the top-right and the bottom-left
+ * j x j blocks of every 2j x 2j block are swapped, rows k and k + j
+ * exchanging their bits with a shift of j. */
+static inline void transpose_block(uint64_t *rows, int size)
 {
-  int count = 0;
-  while (gridline)
+  int step = 0;
+  while ((64 >> (step + 1)) != size / 2)
+    step++;
+
+  for (int j = size / 2; j > 0; j >>= 1, step++)
   {
-    gridline &= (gridline - 1); /* Remove the last non-zero bit */
-    count++;
+    uint64_t mask = transpose_masks[step];
+
+    for (int k = 0; k < size; k = ((k | j) + 1) & ~j)
+    {
+      uint64_t t = ((rows[k] >> j) ^ rows[k | j]) & mask;
+      rows[k] ^= t << j;
+      rows[k | j] ^= t;
+    }
   }
+}
+
+void grid_transpose(binline *src, binline *dst, int size)
+{
+  uint64_t rows[64];
 
-  return count;
+  for (int type = 0; type < 2; type++)
+  {
+    if (size <= 64)
+    {
+      for (int i = 0; i < size; i++)
+        rows[i] = src[i][type].w[0];
+      transpose_block(rows, size);
+      for (int i = 0; i < size; i++)
+      {
+        dst[i][type] = bits_zero();
+        dst[i][type].w[0] = rows[i];
+      }
+      continue;
+    }
+
+    /* Wider lines are 64 x 64 blocks : block (a, b) of `src` is block
+     * (b, a) of `dst`, transposed. */
+    for (int a = 0; a < size / 64; a++)
+    {
+      for (int b = 0; b < size / 64; b++)
+      {
+        for (int i = 0; i < 64; i++)
+          rows[i] = src[64 * a + i][type].w[b];
+        transpose_block(rows, 64);
+        for (int i = 0; i < 64; i++)
+          dst[64 * b + i][type].w[a] = rows[i];
+      }
+    }
+  }
 }
 
 bool no_identical_lines(t_grid *grid)
 {
-  uint64_t full_line = (0xFFFFFFFFFFFFFFFF >> (MAX_GRID_SIZE - grid->size));
+  t_bits full_line = bits_full(grid->size);
 
   for (int k = 0; k < grid->size; k++)
   {
-    if (too_many(1, grid->lines) || too_many(0, grid->lines))
+    if (too_many(1, LINE) || too_many(0, LINE))
     {
       /* Too many 0/1 on line k. */
       return false;
     }
 
-    if (too_many(1, grid->columns) || too_many(0, grid->columns))
+    if (too_many(1, COLUMN) || too_many(0, COLUMN))
     {
       /* Too many 0/1 on column k. */
       return false;
     }
   }
 
+  /* The sets are rebuilt from scratch : each full line is checked against
+   * the previous ones with a single lookup. */
+  lineset_clear(&grid->completed[LINE]);
+  lineset_clear(&grid->completed[COLUMN]);
+
   for (int k = 0; k < grid->size; k++)
   {
-    /* Check if other lines are identical only if line is full. */
     if line_is_full (k, grid->lines)
     {
-      for (int l = k + 1; l < grid->size; l++)
-      {
-        if (identical(grid->lines, k, l))
-        {
-          /* Lines k and l are identical. */
-          return false;
-        }
-      }
+      if (!lineset_insert(&grid->completed[LINE], grid->lines, k))
+        return false; /* Line k is identical to a previous one. */
     }
 
     if line_is_full (k, grid->columns)
     {
-      for (int l = k + 1; l < grid->size; l++)
-      {
-        if (identical(grid->columns, k, l))
-        {
-          /* Columns k and l are identical */
-          return false;
-        }
-      }
+      if (!lineset_insert(&grid->completed[COLUMN], grid->columns, k))
+        return false; /* Column k is identical to a previous one. */
     }
   }
   return true;
@@ -235,34 +584,115 @@ bool no_identical_lines(t_grid *grid)
 
 bool no_three_in_a_row(t_grid *grid)
 {
+  /* The masks test the whole line at once. */
   for (int i = 0; i < grid->size; i++)
   {
-    for (int j = 0; j < (grid->size - 2); j++)
-    {
-      if three_in_a_row_on_a_line (1)
-        return false;
+    if three_in_a_row_on_a_line (1)
+      return false;
 
-      if three_in_a_row_on_a_line (0)
-        return false;
+    if three_in_a_row_on_a_line (0)
+      return false;
 
-      if three_in_a_row_on_a_column (1)
-        return false;
+    if three_in_a_row_on_a_column (1)
+      return false;
+
+    if three_in_a_row_on_a_column (0)
+      return false;
+  }
+  return true;
+}
+
+bool is_consistent(t_grid *grid)
+{
+  if (!(no_identical_lines(grid) && no_three_in_a_row(grid)))
+    return false;
+
+  /* Everything has been checked. */
+  grid->dirty[LINE] = bits_zero();
+  grid->dirty[COLUMN] = bits_zero();
+  return true;
+}
+
+/* Checks the line k of `axis` alone : counts, three in a row and, if it is
+ * full, that no other full line of the axis, all in `completed`, is
+ * identical. `count` holds the zeros and ones of the line. */
+static KERNEL_INLINE bool line_is_consistent(binline *axis,
+                                             const uint16_t count[2],
+                                             t_lineset *completed, int k,
+                                             int size)
+{
+  t_bits full_line = bits_full(size);
 
-      if three_in_a_row_on_a_column (0)
+  if ((count[1] > size / 2) || (count[0] > size / 2))
+    return false;
+
+  if (three_in_a_row(axis[k][1]) || three_in_a_row(axis[k][0]))
+    return false;
+
+  if line_is_full (k, axis)
+    return lineset_insert(completed, axis, k);
+
+  return true;
+}
+
+/* is_consistent_incremental for grids of `size`. */
+static KERNEL_INLINE bool consistent_incremental(t_grid *grid, int size)
+{
+  binline *axes[2] = {grid->lines, grid->columns};
+
+  for (int axis = LINE; axis <= COLUMN; axis++)
+  {
+    t_bits dirty = grid->dirty[axis];
+    while (bits_any(dirty))
+    {
+      int k = bits_pop(&dirty);
+      if (!line_is_consistent(axes[axis], grid->counts[axis][k],
+                              &grid->completed[axis], k, size))
         return false;
     }
   }
+
+  grid->dirty[LINE] = bits_zero();
+  grid->dirty[COLUMN] = bits_zero();
   return true;
 }
 
-bool is_consistent(t_grid *grid)
+bool is_consistent_incremental(t_grid *grid)
 {
-  return no_identical_lines(grid) && no_three_in_a_row(grid);
+  return consistent_incremental(grid, grid->size);
+}
+
+void grid_mark_dirty(t_grid *grid)
+{
+  t_bits full_line = bits_full(grid->size);
+  grid->dirty[LINE] = full_line;
+  grid->dirty[COLUMN] = full_line;
+  grid->queue[LINE] = full_line;
+  grid->queue[COLUMN] = full_line;
+  grid_recount(grid);
+}
+
+/* Counts the zeros and ones of every line of the `mode` axis again. */
+static void axis_recount(t_grid *grid, axis_mode mode)
+{
+  binline *axis = (mode == LINE) ? grid->lines : grid->columns;
+
+  for (int k = 0; k < grid->size; k++)
+  {
+    grid->counts[mode][k][0] = gridline_count(axis[k][0]);
+    grid->counts[mode][k][1] = gridline_count(axis[k][1]);
+  }
+}
+
+void grid_recount(t_grid *grid)
+{
+  axis_recount(grid, LINE);
+  axis_recount(grid, COLUMN);
 }
 
 bool is_full(t_grid *grid)
 {
-  uint64_t full_line = (0xFFFFFFFFFFFFFFFF >> (MAX_GRID_SIZE - grid->size));
+  t_bits full_line = bits_full(grid->size);
 
   for (int i = 0; i < grid->size; i++)
   {
@@ -278,301 +708,481 @@ bool is_valid(t_grid *grid)
   return is_full(grid) && is_consistent(grid);
 }
 
-static bool consec_subheuristic(t_grid *grid, int i, int type)
+/* Returns the cells of a line which must be the opposite of `type` because
+ * they are next to two consecutive `type` : `pairs` has its bits activated
+ * on the first cell of each pair, the cells before and after the pair are
+ * then `pairs >> 1` and `pairs << 2`. */
+static inline t_bits consec_forced(const t_bits *line,
+                                   const uint16_t count[2], int type,
+                                   int size)
 {
-  uint64_t temp_binary;
-  bool change = false;
+  (void)count;
+  t_bits full_line = bits_full(size);
+  t_bits pairs = bits_and(line[type], bits_shr(line[type], 1));
 
-  /* LINES */
+  return bits_and(bits_or(bits_shr(pairs, 1), bits_shl(pairs, 2)), full_line);
+}
+
+/* Returns the cells of a line which are surrounded by two `type` :
+ * `around` has its bits activated one cell before them. */
+static inline t_bits inbetween_forced(const t_bits *line,
+                                      const uint16_t count[2], int type,
+                                      int size)
+{
+  (void)count;
+  t_bits full_line = bits_full(size);
+  t_bits around = bits_and(line[type], bits_shr(line[type], 2));
+
+  return bits_and(bits_shl(around, 1), full_line);
+}
+
+/* Returns the empty cells of a line which already has half of its cells
+ * filled with `type`, read from the counts of the line. */
+static inline t_bits half_line_forced(const t_bits *line,
+                                      const uint16_t count[2], int type,
+                                      int size)
+{
+  t_bits full_line = bits_full(size);
+  int opposite = (type + 1) % 2;
 
-  temp_binary = grid->lines[i][type] & (grid->lines[i][type] >> 1);
-  /* `temp_binary` represents a binary integer with its bits activated only
-   * where there are two identical characters of `type` (ZERO or ONE) on
-   * the line i of the grid. */
+  if ((count[type] == size / 2) && (count[opposite] < size / 2))
+    return bits_andnot(full_line, bits_or(line[0], line[1]));
 
-  for (int count = 0; count < grid->size - 1; count++)
+  return bits_zero();
+}
+
+/* Returns the empty cells of a line which are the opposite of `type` in
+ * every legal completion of the line. */
+static t_bits line_table_forced(const t_bits *line, const uint16_t count[2],
+                                int type, int size)
+{
+  (void)count;
+  t_bits forced[2];
+  line_forced(line, size, forced);
+
+  return forced[(type + 1) % 2];
+}
+
+/* Same as line_table_forced for the sizes without a table. */
+static t_bits line_dp_forced_rule(const t_bits *line, const uint16_t count[2],
+                                  int type, int size)
+{
+  (void)count;
+  t_bits forced[2];
+  line_dp_forced(line, size, forced);
+
+  return forced[(type + 1) % 2];
+}
+
+/* A rule returns the cells of a line which must be the opposite of `type`,
+ * `count` holds the zeros and ones of the line. Rules only look at one
+ * line, they don't know about the other axis. */
+typedef t_bits (*line_rule)(const t_bits *line, const uint16_t count[2],
+                            int type, int size);
+
+/* Applies `rule` on line i of `axis` and nothing else, counts the cells it
+ * filled in `count`, the zeros and ones of the line, and returns them. */
+static KERNEL_INLINE t_bits rule_on_line(binline *axis, uint16_t count[2],
+                                         int i, int size, line_rule rule,
+                                         rule_id id)
+{
+  t_bits filled = bits_zero();
+
+  rule_stats.visits[id]++;
+  for (int type = 0; type < 2; type++)
   {
-    if (((temp_binary >> count) & 1) == 1)
-    {
-      if (count != 0) /* The 2 subsequent identical characters aren't */
-      {               /* on the edge. */
-        if (!(grid->lines[i][(type + 1) % 2] >> (count - 1) & 1))
-        {
-          grid->lines[i][(type + 1) % 2] |= singleton(count - 1);
-          grid->columns[count - 1][(type + 1) % 2] |= singleton(i);
-          change = true;
-        } /* Fill the surrounding cells only if they aren't yet. */
-      }
+    int opposite = (type + 1) % 2;
+    t_bits forced =
+        bits_andnot(rule(axis[i], count, type, size), axis[i][opposite]);
 
-      if (count != (grid->size - 2)) /* The 2 subsequent identical characters */
-      {                              /* aren't on the other edge. */
-        if (!(grid->lines[i][(type + 1) % 2] >> (count + 2) & 1))
-        {
-          grid->lines[i][(type + 1) % 2] |= singleton(count + 2);
-          grid->columns[count + 2][(type + 1) % 2] |= singleton(i);
-          change = true;
-        }
-      }
+    if (bits_any(forced))
+    {
+      int cells = gridline_count(forced);
+      axis[i][opposite] = bits_or(axis[i][opposite], forced);
+      count[opposite] += cells;
+      rule_stats.forced[id] += cells;
+      filled = bits_or(filled, forced);
     }
   }
 
-  /* COLUMNS */
+  return filled;
+}
 
-  temp_binary = grid->columns[i][type] & (grid->columns[i][type] >> 1);
+/* Applies `rule` on every line of the `mode` axis and nothing else,
+ * returns true if a cell was filled. The changed lines are marked in the
+ * masks of the axis and the changed cells in the masks of the other
+ * one. */
+static inline bool rule_on_lines(t_grid *grid, axis_mode mode, line_rule rule,
+                                 rule_id id)
+{
+  binline *axis = (mode == LINE) ? grid->lines : grid->columns;
+  axis_mode other = (mode == LINE) ? COLUMN : LINE;
+  bool change = false;
 
-  for (int count = 0; count < grid->size - 1; count++)
+  for (int i = 0; i < grid->size; i++)
   {
-    if (((temp_binary >> count) & 1) == 1)
+    t_bits filled =
+        rule_on_line(axis, grid->counts[mode][i], i, grid->size, rule, id);
+
+    if (bits_any(filled))
     {
-      if (count != 0)
-      {
-        if (!(grid->columns[i][(type + 1) % 2] >> (count - 1) & 1))
-        {
-          grid->columns[i][(type + 1) % 2] |= singleton(count - 1);
-          grid->lines[count - 1][(type + 1) % 2] |= singleton(i);
-          change = true;
-        }
-      }
-      if (count != (grid->size - 2))
-      {
-        if (!(grid->columns[i][(type + 1) % 2] >> (count + 2) & 1))
-        {
-          grid->columns[i][(type + 1) % 2] |= singleton(count + 2);
-          grid->lines[count + 2][(type + 1) % 2] |= singleton(i);
-          change = true;
-        }
-      }
+      bits_set(&grid->dirty[mode], i);
+      bits_set(&grid->queue[mode], i);
+      grid->dirty[other] = bits_or(grid->dirty[other], filled);
+      grid->queue[other] = bits_or(grid->queue[other], filled);
+      change = true;
     }
   }
 
   return change;
 }
 
-bool consecutive_cells_heuristic(t_grid *grid)
+/* Applies `rule` on the lines then on the columns of the grid. Instead of
+ * writing each cell in both axes, the other axis is regenerated with one
+ * transpose, and counted again, when the rule changed something. */
+static inline bool rule_on_grid(t_grid *grid, line_rule rule, rule_id id)
 {
   bool change = false;
 
-  for (int i = 0; i < grid->size; i++)
+  if (rule_on_lines(grid, LINE, rule, id))
   {
-    change = change || consec_subheuristic(grid, i, 1);
-    change = change || consec_subheuristic(grid, i, 0);
+    grid_transpose(grid->lines, grid->columns, grid->size);
+    axis_recount(grid, COLUMN);
+    change = true;
   }
+
+  if (rule_on_lines(grid, COLUMN, rule, id))
+  {
+    grid_transpose(grid->columns, grid->lines, grid->size);
+    axis_recount(grid, LINE);
+    change = true;
+  }
+
   return change;
 }
 
-bool half_line_filled(t_grid *grid, int i, int halfsize)
+bool consecutive_cells_heuristic(t_grid *grid)
 {
-  bool change = false;
+  return rule_on_grid(grid, consec_forced, RULE_CONSECUTIVE);
+}
+
+bool half_line_heuristic(t_grid *grid)
+{
+  return rule_on_grid(grid, half_line_forced, RULE_HALF_LINE);
+}
+
+bool inbetween_cells_heuristic(t_grid *grid)
+{
+  return rule_on_grid(grid, inbetween_forced, RULE_INBETWEEN);
+}
+
+bool line_table_heuristic(t_grid *grid)
+{
+  if (grid->size > TABLE_MAX_SIZE)
+    return false;
+
+  return rule_on_grid(grid, line_table_forced, RULE_WHOLE_LINE);
+}
+
+bool line_dp_heuristic(t_grid *grid)
+{
+  if (grid->size <= TABLE_MAX_SIZE)
+    return false;
 
-  /* LINES */
+  return rule_on_grid(grid, line_dp_forced_rule, RULE_WHOLE_LINE);
+}
 
-  int onescount = gridline_count(grid->lines[i][1]);
-  int zeroscount = gridline_count(grid->lines[i][0]);
+bool grid_heuristics_sweep(t_grid *grid)
+{
+  if (!is_consistent_incremental(grid))
+  {
+    return false;
+  }
+
+  /* `grid` is consistent. */
+  bool keep_going = true;
 
-  if (onescount == halfsize)
+  /* Each change of the heuristics is checked right away, the grid is
+   * valid as soon as it is full. */
+  while (keep_going & !is_full(grid))
   {
-    if (zeroscount < halfsize)
+    keep_going = false;
+
+    while (consecutive_cells_heuristic(grid))
     {
-      for (int j = 0; j < grid->size; j++)
+      if (!is_consistent_incremental(grid))
       {
-        if (is_empty(i, j))
-        {
-          change = true;
-          grid->lines[i][0] |= singleton(j);
-          grid->columns[j][0] |= singleton(i);
-        }
+        return false;
       }
+      keep_going = true;
     }
-  }
 
-  if (zeroscount == halfsize)
-  {
-    if (onescount < halfsize)
+    while (inbetween_cells_heuristic(grid))
     {
-      for (int j = 0; j < grid->size; j++)
+      if (!is_consistent_incremental(grid))
       {
-        if (is_empty(i, j))
-        {
-          change = true;
-          grid->lines[i][1] |= singleton(j);
-          grid->columns[j][1] |= singleton(i);
-        }
+        return false;
       }
+      keep_going = true;
     }
-  }
-
-  /* COLUMNS */
 
-  onescount = gridline_count(grid->columns[i][1]);
-  zeroscount = gridline_count(grid->columns[i][0]);
-
-  if (onescount == halfsize)
-  {
-    if (zeroscount < halfsize)
+    while (half_line_heuristic(grid))
     {
-      for (int j = 0; j < grid->size; j++)
+      if (!is_consistent_incremental(grid))
       {
-
-        if (is_empty(j, i))
-        {
-          change = true;
-          grid->columns[i][0] |= singleton(j);
-          grid->lines[j][0] |= singleton(i);
-        }
+        return false;
       }
+      keep_going = true;
     }
-  }
 
-  if (zeroscount == halfsize)
-  {
-    if (onescount < halfsize)
+    /* The local rules are stuck, look at whole lines. */
+    if (line_table_heuristic(grid) || line_dp_heuristic(grid))
     {
-      for (int j = 0; j < grid->size; j++)
+      if (!is_consistent_incremental(grid))
       {
-        if (is_empty(j, i))
-        {
-          change = true;
-          grid->columns[i][1] |= singleton(j);
-          grid->lines[j][1] |= singleton(i);
-        }
+        return false;
       }
+      keep_going = true;
     }
   }
 
-  return change;
+  /* Heuristics aren't modifying the grid anymore, nothing is left to
+   * propagate. */
+  grid->queue[LINE] = bits_zero();
+  grid->queue[COLUMN] = bits_zero();
+  return is_consistent_incremental(grid);
 }
 
-bool half_line_heuristic(t_grid *grid)
+/* Applies the local rule `id` on line k of `axis` : the rule is a
+ * constant in each case, so it is inlined. */
+static KERNEL_INLINE t_bits local_rule_on_line(binline *axis,
+                                               uint16_t count[2], int k,
+                                               int size, rule_id id)
 {
-  bool change = false;
-  int halfsize = grid->size / 2;
-
-  for (int i = 0; i < grid->size; i++)
+  switch (id)
   {
-    change = change || half_line_filled(grid, i, halfsize);
+  case RULE_CONSECUTIVE:
+    return rule_on_line(axis, count, k, size, consec_forced, id);
+  case RULE_INBETWEEN:
+    return rule_on_line(axis, count, k, size, inbetween_forced, id);
+  default:
+    return rule_on_line(axis, count, k, size, half_line_forced, id);
   }
-
-  return change;
 }
 
-static bool inbetween_subheuristic(t_grid *grid, int i, int type)
+/* Runs the rules up to `limit` on line k of the `mode` axis until they
+ * are stuck, then writes the filled cells in the other axis and queues
+ * their lines. The local rules run the cheapest first. A line fills a few
+ * cells : writing them one by one is cheaper than a transpose of the
+ * other axis after each pass, which doubles the time per node on 64x64
+ * grids. */
+static KERNEL_INLINE void propagate_line(t_grid *grid, axis_mode mode, int k,
+                                         rule_id limit, int size)
 {
-  uint64_t temp_binary;
-  bool change = false;
+  binline *axis = (mode == LINE) ? grid->lines : grid->columns;
+  binline *other_axis = (mode == LINE) ? grid->columns : grid->lines;
+  axis_mode other = (mode == LINE) ? COLUMN : LINE;
+  uint16_t *count = grid->counts[mode][k];
+  t_bits full_line = bits_full(size);
+  t_bits filled = bits_zero();
+  bool change = true;
+
+  while (change && !line_is_full(k, axis))
+  {
+    change = false;
+    for (rule_id r = RULE_CONSECUTIVE; r <= limit && r <= RULE_HALF_LINE; r++)
+    {
+      t_bits forced = local_rule_on_line(axis, count, k, size, r);
+      filled = bits_or(filled, forced);
+      change = change || bits_any(forced);
+    }
+  }
 
-  /* LINES */
+  /* The whole line rule finds everything the local rules can, once is
+   * enough. */
+  if (limit >= RULE_WHOLE_LINE && !line_is_full(k, axis))
+  {
+    line_rule whole =
+        (size <= TABLE_MAX_SIZE) ? line_table_forced : line_dp_forced_rule;
+    filled = bits_or(filled, rule_on_line(axis, count, k, size, whole,
+                                          RULE_WHOLE_LINE));
+  }
 
-  temp_binary = grid->lines[i][type] & (grid->lines[i][type] >> 2);
-  /* `temp_binary` here acts the same way as in the consecutive cells
-   * heuristic, only this time the bits are activated only where 2 of
-   * the same characters are surrounding a cell */
+  if (!bits_any(filled))
+    return;
 
-  for (int count = 0; count < grid->size - 2; count++)
+  for (t_bits cells = filled; bits_any(cells);)
   {
-    if (((temp_binary >> count) & 1) == 1)
+    int j = bits_pop(&cells);
+    for (int type = 0; type < 2; type++)
     {
-      /* Here we don't need to test if the bit is on the edge! */
-      if (!(grid->lines[i][(type + 1) % 2] >> (count + 1) & 1))
+      /* A conflicting cell has both values, one of them already there. */
+      if (bits_test(axis[k][type], j) && !bits_test(other_axis[j][type], k))
       {
-        /* The cell isn't filled yet. */
-        grid->lines[i][(type + 1) % 2] |= singleton(count + 1);
-        grid->columns[count + 1][(type + 1) % 2] |= singleton(i);
-        change = true;
+        bits_set(&other_axis[j][type], k);
+        grid->counts[other][j][type]++;
       }
     }
   }
 
-  /* COLUMNS */
+  bits_set(&grid->dirty[mode], k);
+  grid->dirty[other] = bits_or(grid->dirty[other], filled);
+  grid->queue[other] = bits_or(grid->queue[other], filled);
+}
 
-  temp_binary = grid->columns[i][type] & (grid->columns[i][type] >> 2);
+/* grid_heuristics with the rules up to `limit`, for grids of `size`. */
+static KERNEL_INLINE bool propagate_queue_sized(t_grid *grid, rule_id limit,
+                                                int size)
+{
+  if (!consistent_incremental(grid, size))
+  {
+    return false;
+  }
 
-  for (int count = 0; count < grid->size - 2; count++)
+  /* Each line is checked as soon as it has been propagated, with the
+   * crossing lines it changed. */
+  while (bits_any(bits_or(grid->queue[LINE], grid->queue[COLUMN])))
   {
-    if (((temp_binary >> count) & 1) == 1)
+    for (axis_mode mode = LINE; mode <= COLUMN; mode++)
     {
-      if (!(grid->columns[i][(type + 1) % 2] >> (count + 1) & 1))
+      while (bits_any(grid->queue[mode]))
       {
-        grid->columns[i][(type + 1) % 2] |= singleton(count + 1);
-        grid->lines[count + 1][(type + 1) % 2] |= singleton(i);
-        change = true;
+        int k = bits_pop(&grid->queue[mode]);
+
+        propagate_line(grid, mode, k, limit, size);
+        if (!consistent_incremental(grid, size))
+        {
+          return false;
+        }
       }
     }
   }
 
-  return change;
+  return true;
 }
 
-bool inbetween_cells_heuristic(t_grid *grid)
-{
-  bool change = false;
+/* The propagation of grids of size n, compiled with n as a constant : the
+ * masks of the rules are constants, the whole line rule is chosen at
+ * compile time and the rules are inlined. */
+#define PROPAGATE_KERNEL(n)                                                   \
+  static bool propagate_queue_##n(t_grid *grid, rule_id limit)               \
+  {                                                                           \
+    return propagate_queue_sized(grid, limit, n);                             \
+  }                                                                           \
+  static bool grid_heuristics_##n(t_grid *grid)                              \
+  {                                                                           \
+    return propagate_queue_sized(grid, RULE_WHOLE_LINE, n);                   \
+  }
 
-  for (int i = 0; i < grid->size; i++)
+PROPAGATE_KERNEL(4)
+PROPAGATE_KERNEL(8)
+PROPAGATE_KERNEL(16)
+PROPAGATE_KERNEL(32)
+PROPAGATE_KERNEL(64)
+#if MAX_GRID_SIZE >= 128
+PROPAGATE_KERNEL(128)
+#endif
+#if MAX_GRID_SIZE >= 256
+PROPAGATE_KERNEL(256)
+#endif
+
+static inline bool propagate_queue(t_grid *grid, rule_id limit)
+{
+  switch (grid->size)
   {
-    change = change || inbetween_subheuristic(grid, i, 1);
-    change = change || inbetween_subheuristic(grid, i, 0);
+  case 4:
+    return propagate_queue_4(grid, limit);
+  case 8:
+    return propagate_queue_8(grid, limit);
+  case 16:
+    return propagate_queue_16(grid, limit);
+  case 32:
+    return propagate_queue_32(grid, limit);
+#if MAX_GRID_SIZE >= 128
+  case 128:
+    return propagate_queue_128(grid, limit);
+#endif
+#if MAX_GRID_SIZE >= 256
+  case 256:
+    return propagate_queue_256(grid, limit);
+#endif
+  default:
+    return propagate_queue_64(grid, limit);
   }
-
-  return change;
 }
 
-bool grid_heuristics(t_grid *grid)
+t_heuristics grid_heuristics_kernel(int size)
 {
-  if (!is_consistent(grid))
+  switch (size)
   {
-    return false;
+  case 4:
+    return grid_heuristics_4;
+  case 8:
+    return grid_heuristics_8;
+  case 16:
+    return grid_heuristics_16;
+  case 32:
+    return grid_heuristics_32;
+#if MAX_GRID_SIZE >= 128
+  case 128:
+    return grid_heuristics_128;
+#endif
+#if MAX_GRID_SIZE >= 256
+  case 256:
+    return grid_heuristics_256;
+#endif
+  default:
+    return grid_heuristics_64;
   }
+}
 
-  /* `grid` is consistent. */
-  bool keep_going = true;
+bool grid_heuristics(t_grid *grid)
+{
+  return propagate_queue(grid, RULE_WHOLE_LINE);
+}
 
-  while (keep_going & !is_valid(grid))
-  {
-    keep_going = false;
+bool grid_heuristics_limited(t_grid *grid, rule_id limit)
+{
+  return propagate_queue(grid, limit);
+}
 
-    while (consecutive_cells_heuristic(grid))
-    {
-      if (!is_consistent(grid))
-      {
-        return false;
-      }
-      keep_going = true;
-    }
+rule_id grid_hardest_rule(t_grid *grid)
+{
+  /* The two patterns of three cells are the easiest step. */
+  rule_id limit = RULE_INBETWEEN;
 
-    while (inbetween_cells_heuristic(grid))
-    {
-      if (!is_consistent(grid))
-      {
-        return false;
-      }
-      keep_going = true;
-    }
+  while (propagate_queue(grid, limit))
+  {
+    if (is_full(grid))
+      return limit;
+    if (limit == RULE_WHOLE_LINE)
+      break;
 
-    while (half_line_heuristic(grid))
-    {
-      if (!is_consistent(grid))
-      {
-        return false;
-      }
-      keep_going = true;
-    }
+    /* Every line may give something to the next rule. */
+    limit++;
+    grid_mark_dirty(grid);
   }
 
-  /* Heuristics aren't modifying the grid anymore. */
-  return is_consistent(grid);
+  return RULE_COUNT;
+}
+
+void rule_stats_get(t_rule_stats *stats)
+{
+  *stats = rule_stats;
 }
 
 void grid_choice_apply(t_grid *grid, const choice_t choice)
 {
+  mark_cell(choice.row, choice.column, grid);
+
   switch (choice.choice)
   {
   case ONE:
-    grid->lines[choice.row][1] |= singleton(choice.column);
-    grid->columns[choice.column][1] |= singleton(choice.row);
+    fill_cell(choice.row, choice.column, grid, 1);
     break;
 
   case ZERO:
-    grid->lines[choice.row][0] |= singleton(choice.column);
-    grid->columns[choice.column][0] |= singleton(choice.row);
+    fill_cell(choice.row, choice.column, grid, 0);
     break;
 
   default:
@@ -585,17 +1195,16 @@ void grid_choice_apply(t_grid *grid, const choice_t choice)
 void grid_choice_apply_opposite(t_grid *grid, const choice_t choice)
 {
   set_empty(choice.row, choice.column, grid);
+  mark_cell(choice.row, choice.column, grid);
 
   switch (choice.choice)
   {
   case ZERO:
-    grid->lines[choice.row][1] |= singleton(choice.column);
-    grid->columns[choice.column][1] |= singleton(choice.row);
+    fill_cell(choice.row, choice.column, grid, 1);
     break;
 
   case ONE:
-    grid->lines[choice.row][0] |= singleton(choice.column);
-    grid->columns[choice.column][0] |= singleton(choice.row);
+    fill_cell(choice.row, choice.column, grid, 0);
     break;
 
   default:
@@ -613,25 +1222,26 @@ void grid_choice_print(const choice_t choice, FILE *fd)
 /* We want to find the most isolated bit of the line to make heuristics
  * more effective after our choice.
  * ((empty_positions & (empty_positions >> 1))) reduces consecutive bit
- * subset size by 1, if one bit is isolated, it will disappear. */
-static inline uint64_t find_isolated_bit(uint64_t empty_positions)
+ * subset size by 1, if one bit is isolated, it will disappear. Returns the
+ * isolated bits of the first reduced subset which has some. */
+static inline t_bits find_isolated_bit(t_bits empty_positions)
 {
   while (true)
   {
-    uint64_t two_consec = (empty_positions & (empty_positions >> 1));
+    t_bits two_consec =
+        bits_and(empty_positions, bits_shr(empty_positions, 1));
+    t_bits paired = bits_or(two_consec, bits_shl(two_consec, 1));
 
-    if (empty_positions == (two_consec | (two_consec << 1)))
+    if (bits_equal(empty_positions, paired))
     {
-      empty_positions &= (empty_positions >> 1);
+      empty_positions = two_consec;
     }
 
     else
     {
-      break;
+      return bits_andnot(empty_positions, paired);
     }
   }
-  
-  return empty_positions;
 }
 
 choice_t grid_choice(t_grid *grid)
@@ -648,8 +1258,7 @@ choice_t grid_choice(t_grid *grid)
   /* Look for the most filled line. */
   for (int i = 0; i < grid->size; i++)
   {
-    int count = gridline_count(grid->lines[i][1]) +
-                gridline_count(grid->lines[i][0]);
+    int count = grid->counts[LINE][i][1] + grid->counts[LINE][i][0];
     if ((count > max) && (count < grid->size))
     {
       max = count;
@@ -661,8 +1270,7 @@ choice_t grid_choice(t_grid *grid)
   /* Look if there is a column more filled than the most filled line. */
   for (int i = 0; i < grid->size; i++)
   {
-    int count = gridline_count(grid->columns[i][1]) +
-                gridline_count(grid->columns[i][0]);
+    int count = grid->counts[COLUMN][i][1] + grid->counts[COLUMN][i][0];
     if ((count > max) && (count < grid->size))
     {
       max = count;
@@ -676,23 +1284,13 @@ choice_t grid_choice(t_grid *grid)
   /* Choice is on a LINE. */
   if (!axis)
   {
-    uint64_t empty_positions = ~(grid->lines[max_index][0] |
-                                 grid->lines[max_index][1]);
-    /* `empty_positions` is a binary integer with its bit activated where
-     * there is an empty bit on the line we are looking at. */
+    t_bits empty_positions = bits_andnot(bits_full(grid->size),
+                                         bits_or(grid->lines[max_index][0],
+                                                 grid->lines[max_index][1]));
+    /* `empty_positions` has its bit activated where there is an empty bit
+     * on the line we are looking at, up to grid->size. */
 
-    empty_positions = empty_positions &
-                      (0xFFFFFFFFFFFFFFFF >> (MAX_GRID_SIZE - grid->size));
-    /* This step is to make sure `empty_positions` isn't too small, we fill
-     * it up to grid->size. */
-
-    find_isolated_bit(empty_positions);
-
-    int i = 0;
-    while (((empty_positions >> i) & 1) != 1)
-    {
-      i++;
-    }
+    int i = bits_lowest(find_isolated_bit(empty_positions));
 
     choice.row = max_index;
     choice.column = i;
@@ -702,19 +1300,11 @@ choice_t grid_choice(t_grid *grid)
   /* Choice is on a COLUMN. */
   else 
   {
-    uint64_t empty_positions = ~(grid->columns[max_index][0] | 
-                                 grid->columns[max_index][1]);
-   
-    empty_positions = empty_positions & 
-      (0xFFFFFFFFFFFFFFFF >> (MAX_GRID_SIZE - grid->size));
+    t_bits empty_positions = bits_andnot(bits_full(grid->size),
+                                         bits_or(grid->columns[max_index][0],
+                                                 grid->columns[max_index][1]));
 
-    find_isolated_bit(empty_positions);
-
-    int i = 0;
-    while (((empty_positions >> i) & 1) != 1)
-    {
-      i++;
-    }
+    int i = bits_lowest(find_isolated_bit(empty_positions));
 
     choice.column = max_index;
     choice.row = i;
@@ -723,138 +1313,3 @@ choice_t grid_choice(t_grid *grid)
 
   return choice;
 }
-
-void grid_set_corners(t_grid *grid)
-{
-  /* TOP LEFT CORNER */
-  int temp = (rand() % 2);
-  int opposite = (temp + 1) % 2;
-
-  grid->lines[0][temp] |= singleton(0);
-  grid->columns[0][temp] |= singleton(0);
-
-  grid->lines[0][opposite] |= singleton(1);
-  grid->columns[1][opposite] |= singleton(0);
-
-  grid->lines[1][temp] |= singleton(1);
-  grid->columns[1][temp] |= singleton(1);
-
-  grid->lines[1][opposite] |= singleton(0);
-  grid->columns[0][opposite] |= singleton(1);
-
-  /* TOP RIGHT CORNER */
-  temp = (rand() % 2);
-  opposite = (temp + 1) % 2;
-
-  grid->lines[0][temp] |= singleton((grid->size - 1));
-  grid->columns[grid->size - 1][temp] |= singleton(0);
-
-  grid->lines[0][opposite] |= singleton((grid->size - 2));
-  grid->columns[(grid->size - 2)][opposite] |= singleton(0);
-
-  grid->lines[1][temp] |= singleton((grid->size - 2));
-  grid->columns[(grid->size - 2)][temp] |= singleton(1);
-
-  grid->lines[1][opposite] |= singleton(grid->size - 1);
-  grid->columns[grid->size - 1][opposite] |= singleton(1);
-
-  /* BOTTOM LEFT CORNER */
-  temp = (rand() % 2);
-  opposite = (temp + 1) % 2;
-
-  grid->lines[grid->size - 1][temp] |= singleton(0);
-  grid->columns[0][temp] |= singleton(grid->size - 1);
-
-  grid->lines[grid->size - 1][opposite] |= singleton(1);
-  grid->columns[1][opposite] |= singleton(grid->size - 1);
-
-  grid->lines[grid->size - 2][temp] |= singleton(1);
-  grid->columns[1][temp] |= singleton((grid->size - 2));
-
-  grid->lines[grid->size - 2][opposite] |= singleton(0);
-  grid->columns[0][opposite] |= singleton((grid->size - 2));
-
-  /* BOTTOM RIGHT CORNER */
-  temp = (rand() % 2);
-  opposite = (temp + 1) % 2;
-
-  grid->lines[grid->size - 1][temp] |= singleton(grid->size - 1);
-  grid->columns[grid->size - 1][temp] |= singleton(grid->size - 1);
-
-  grid->lines[grid->size - 1][opposite] |= singleton((grid->size - 2));
-  grid->columns[grid->size - 2][opposite] |= singleton(grid->size - 1);
-
-  grid->lines[grid->size - 2][temp] |= singleton((grid->size - 2));
-  grid->columns[grid->size - 2][temp] |= singleton((grid->size - 2));
-
-  grid->lines[grid->size - 2][opposite] |= singleton(grid->size - 1);
-  grid->columns[grid->size - 1][opposite] |= singleton((grid->size - 2));
-}
-
-void grid_outer_ring(t_grid *grid)
-{
-  grid_set_corners(grid);
-
-  for (int i = 2; i < grid->size - 2; i++)
-  {
-    /* LEFT COLUMN */
-    int temp = (rand() % 2);
-
-    if (((grid->lines[i - 1][temp] & singleton(0)) != 0) &&
-       ((grid->lines[i - 2][temp] & singleton(0)) != 0))
-    {
-      set_cell(i, 0, grid, ((temp + 1) % 2) + ZERO);
-      set_cell(i, 1, grid, temp + ZERO);
-    }
-    else
-    {
-      set_cell(i, 0, grid, temp + ZERO);
-      set_cell(i, 1, grid, ((temp + 1) % 2) + ZERO);
-    }
-
-    /* TOP LINE */
-    temp = (rand() % 2);
-
-    if (((grid->lines[0][temp] & singleton(i - 1)) != 0) &&
-       ((grid->lines[0][temp] & singleton(i - 2)) != 0))
-    {
-      set_cell(0, i, grid, ((temp + 1) % 2) + ZERO);
-      set_cell(1, i, grid, temp + ZERO);
-    }
-    else
-    {
-      set_cell(0, i, grid, temp + ZERO);
-      set_cell(1, i, grid, ((temp + 1) % 2) + ZERO);
-    }
-
-    /* RIGHT COLUMN */
-    temp = (rand() % 2);
-
-    if (((grid->lines[i - 1][temp] & singleton(grid->size - 1)) != 0) &&
-       ((grid->lines[i - 2][temp] & singleton(grid->size - 1)) != 0))
-    {
-      set_cell(i, grid->size - 1, grid, ((temp + 1) % 2) + ZERO);
-      set_cell(i, grid->size - 2, grid, temp + ZERO);
-    }
-    else
-    {
-      set_cell(i, grid->size - 1, grid, temp + ZERO);
-      set_cell(i, grid->size - 2, grid, ((temp + 1) % 2) + ZERO);
-    }
-
-    /* BOTTOM LINE */
-    temp = (rand() % 2);
-
-    if (((grid->lines[grid->size - 1][temp] & singleton(i - 1)) != 0) &&
-       ((grid->lines[grid->size - 1][temp] & singleton(i - 2)) != 0))
-    {
-      set_cell(grid->size - 1, i, grid, ((temp + 1) % 2) + ZERO);
-      set_cell(grid->size - 2, i, grid, temp + ZERO);
-    }
-    else
-    {
-      set_cell(grid->size - 1, i, grid, temp + ZERO);
-      set_cell(grid->size - 2, i, grid, ((temp + 1) % 2) + ZERO);
-    }
-  }
-}
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "lines.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/* On the words of the lines with a table. */
+#define three_in_a_row(line) (((line) & ((line) >> 1) & ((line) >> 2)) != 0)
+
+/* Every legal full line of sizes 4, 8 and 16 (6, 34 and 1296 lines), given
+ * by its ones plane. They are built once, on first use. */
+static uint16_t *line_table[TABLE_MAX_SIZE + 1];
+static int line_table_size[TABLE_MAX_SIZE + 1];
+static pthread_once_t line_table_once = PTHREAD_ONCE_INIT;
+
+/* The same lines are analysed again and again during the search, each
+ * thread remembers the last results. */
+typedef struct
+{
+  binline key;
+  t_bits forced[2];
+  int size; /* 0 if the entry is empty. */
+} t_line_cache;
+
+static _Thread_local t_line_cache line_cache[LINE_CACHE_SIZE];
+
+typedef struct
+{
+  binline key;
+  uint64_t count;
+  int size; /* 0 if the entry is empty. */
+} t_count_cache;
+
+static _Thread_local t_count_cache count_cache[LINE_CACHE_SIZE];
+
+static bool legal_line(uint64_t ones, int size)
+{
+  uint64_t zeros = ~ones & word_full(size);
+
+  return (word_count(ones) == size / 2) && !three_in_a_row(ones) &&
+         !three_in_a_row(zeros);
+}
+
+static void line_table_build(void)
+{
+  for (int size = MIN_GRID_SIZE; size <= TABLE_MAX_SIZE; size *= 2)
+  {
+    int count = 0;
+    for (uint64_t ones = 0; ones <= word_full(size); ones++)
+    {
+      if (legal_line(ones, size))
+        count++;
+    }
+
+    line_table[size] = malloc(count * sizeof(uint16_t));
+    if (line_table[size] == NULL)
+      errx(EXIT_FAILURE, "error: line table malloc");
+
+    for (uint64_t ones = 0; ones <= word_full(size); ones++)
+    {
+      if (legal_line(ones, size))
+        line_table[size][line_table_size[size]++] = ones;
+    }
+  }
+}
+
+int line_table_count(int size)
+{
+  if (size > TABLE_MAX_SIZE)
+    return 0;
+
+  pthread_once(&line_table_once, line_table_build);
+  return line_table_size[size];
+}
+
+/* AND and OR of the ones planes of the completions of a line. */
+typedef struct
+{
+  t_bits ones;
+  t_bits zeros;
+  t_bits empty;
+  int size;
+  t_bits all_ones; /* Cells which are 1 in every completion seen. */
+  t_bits any_ones; /* Cells which are 1 in at least one completion. */
+  bool found;
+} t_completions;
+
+/* Adds the completion `ones` of a size with a table, which fits in the
+ * first word, and returns true when every empty cell has been seen with
+ * both values : nothing can be forced anymore. */
+static inline bool completion_add(t_completions *c, uint64_t ones)
+{
+  c->all_ones.w[0] &= ones;
+  c->any_ones.w[0] |= ones;
+  c->found = true;
+
+  return (((c->any_ones.w[0] & ~c->all_ones.w[0]) & c->empty.w[0]) ==
+          c->empty.w[0]);
+}
+
+static void table_completions(t_completions *c)
+{
+  int count = line_table_count(c->size);
+  uint16_t *table = line_table[c->size];
+
+  for (int k = 0; k < count; k++)
+  {
+    uint64_t ones = table[k];
+    if (((ones & c->zeros.w[0]) == 0) && ((c->ones.w[0] & ~ones) == 0))
+    {
+      if (completion_add(c, ones))
+        return;
+    }
+  }
+}
+
+/* States of the DP after some cells : [last value][length of the run
+ * ending there, 1 or 2], index 0 of the run is unused. Each state is the
+ * bitset of the numbers of ones which reach it, at most half a line : it
+ * fits in the bits of a line and gets the same word-carrying shifts. */
+typedef t_bits t_states[2][3];
+
+/* Dynamic programming over (position, ones count, trailing run) : a forward
+ * pass finds the states reachable from the start, a backward pass the
+ * states from which the line can be finished, a value fits a cell if it
+ * links two such states. Gives the same `all_ones` and `any_ones` as the
+ * enumeration of every completion, in linear time. */
+static void dp_completions(t_completions *c)
+{
+  int size = c->size;
+  int half = size / 2;
+  t_bits counts = bits_full(half + 1); /* At most `half` ones. */
+  t_bits start = bits_singleton(0);
+
+  /* forward[p] : states reachable after the cells 0..p-1, from the start.
+   * backward[p] : states after the cells 0..p-1 from which the end of the
+   * line can be filled with exactly `half` ones. */
+  t_states forward[MAX_GRID_SIZE + 1];
+  t_states backward[MAX_GRID_SIZE + 1];
+  memset(forward, 0, (size + 1) * sizeof(t_states));
+  memset(backward, 0, (size + 1) * sizeof(t_states));
+
+  /* Before the first cell there is no run : both values start a new run
+   * from the ones count 0 and none of them extends a run. */
+  for (int p = 0; p < size; p++)
+  {
+    bool can_be_1 = !bits_test(c->zeros, p);
+    bool can_be_0 = !bits_test(c->ones, p);
+    t_bits from0 =
+        (p == 0) ? start : bits_or(forward[p][0][1], forward[p][0][2]);
+    t_bits from1 =
+        (p == 0) ? start : bits_or(forward[p][1][1], forward[p][1][2]);
+    t_bits ones_run = (p == 0) ? bits_zero() : forward[p][1][1];
+    t_bits zeros_run = (p == 0) ? bits_zero() : forward[p][0][1];
+
+    /* At most `half` zeros after p + 1 cells : ones >= p + 1 - half. */
+    t_bits few_ones = (p + 1 > half) ? bits_full(p + 1 - half) : bits_zero();
+
+    if (can_be_1)
+    {
+      forward[p + 1][1][1] = bits_and(bits_shl(from0, 1), counts);
+      forward[p + 1][1][2] = bits_and(bits_shl(ones_run, 1), counts);
+    }
+    if (can_be_0)
+    {
+      forward[p + 1][0][1] = bits_andnot(from1, few_ones);
+      forward[p + 1][0][2] = bits_andnot(zeros_run, few_ones);
+    }
+  }
+
+  /* The line ends with exactly `half` ones. */
+  for (int v = 0; v < 2; v++)
+  {
+    backward[size][v][1] = bits_singleton(half);
+    backward[size][v][2] = bits_singleton(half);
+  }
+
+  for (int p = size - 1; p >= 0; p--)
+  {
+    bool can_be_1 = !bits_test(c->zeros, p);
+    bool can_be_0 = !bits_test(c->ones, p);
+
+    /* After a 1 : a 1 makes a run of 2 (only after a run of 1), a 0 starts
+     * a new run. Same thing the other way round after a 0. */
+    t_bits after_one_1 =
+        can_be_1 ? bits_shr(backward[p + 1][1][2], 1) : bits_zero();
+    t_bits new_run_1 =
+        can_be_1 ? bits_shr(backward[p + 1][1][1], 1) : bits_zero();
+    t_bits after_zero_0 = can_be_0 ? backward[p + 1][0][2] : bits_zero();
+    t_bits new_run_0 = can_be_0 ? backward[p + 1][0][1] : bits_zero();
+
+    backward[p][1][1] = bits_or(after_one_1, new_run_0);
+    backward[p][1][2] = new_run_0;
+    backward[p][0][1] = bits_or(after_zero_0, new_run_1);
+    backward[p][0][2] = new_run_1;
+
+    /* Cell p can take a value if a reachable state leads to a state from
+     * which the line can be finished. */
+    t_bits from0 =
+        (p == 0) ? start : bits_or(forward[p][0][1], forward[p][0][2]);
+    t_bits from1 =
+        (p == 0) ? start : bits_or(forward[p][1][1], forward[p][1][2]);
+    t_bits ones_run = (p == 0) ? bits_zero() : forward[p][1][1];
+    t_bits zeros_run = (p == 0) ? bits_zero() : forward[p][0][1];
+
+    bool one = bits_any(bits_and(from0, new_run_1)) ||
+               bits_any(bits_and(ones_run, after_one_1));
+    bool zero = bits_any(bits_and(from1, new_run_0)) ||
+                bits_any(bits_and(zeros_run, after_zero_0));
+
+    if (one)
+      bits_set(&c->any_ones, p);
+    if (zero)
+      bits_reset(&c->all_ones, p);
+    if (!one && !zero)
+      return; /* No completion, `found` stays false. */
+  }
+
+  c->found = true;
+}
+
+/* Computes the forced cells of `line` with `completions`, through the cache
+ * of the thread. */
+static void cached_forced(const t_bits *line, int size, t_bits forced[2],
+                          void (*completions)(t_completions *))
+{
+  forced[0] = bits_zero();
+  forced[1] = bits_zero();
+
+  t_bits empty = bits_andnot(bits_full(size), bits_or(line[0], line[1]));
+  if (!bits_any(empty))
+    return;
+
+  uint64_t hash = bits_hash(line) ^ (uint64_t)size;
+  t_line_cache *entry = &line_cache[hash >> 52];
+
+  if ((entry->size == size) && bits_equal(entry->key[0], line[0]) &&
+      bits_equal(entry->key[1], line[1]))
+  {
+    forced[0] = entry->forced[0];
+    forced[1] = entry->forced[1];
+    return;
+  }
+
+  t_completions c = {.ones = line[1],
+                     .zeros = line[0],
+                     .empty = empty,
+                     .size = size,
+                     .all_ones = bits_full(size),
+                     .any_ones = bits_zero(),
+                     .found = false};
+
+  completions(&c);
+
+  if (!c.found)
+  {
+    /* No completion : every cell gets both values, the line is then
+     * rejected by the consistency check. */
+    forced[0] = bits_full(size);
+    forced[1] = bits_full(size);
+  }
+  else
+  {
+    forced[1] = bits_and(c.all_ones, empty);
+    forced[0] = bits_andnot(empty, c.any_ones);
+  }
+
+  entry->key[0] = line[0];
+  entry->key[1] = line[1];
+  entry->size = size;
+  entry->forced[0] = forced[0];
+  entry->forced[1] = forced[1];
+}
+
+void line_forced(const t_bits *line, int size, t_bits forced[2])
+{
+  if (size > TABLE_MAX_SIZE)
+  {
+    forced[0] = bits_zero();
+    forced[1] = bits_zero();
+    return;
+  }
+
+  cached_forced(line, size, forced, table_completions);
+}
+
+void line_dp_forced(const t_bits *line, int size, t_bits forced[2])
+{
+  cached_forced(line, size, forced, dp_completions);
+}
+
+/* a + b, UINT64_MAX if it overflows. */
+static inline uint64_t saturated_add(uint64_t a, uint64_t b)
+{
+  return (a + b < a) ? UINT64_MAX : a + b;
+}
+
+uint64_t line_completions(const t_bits *line, int size)
+{
+  uint64_t hash = bits_hash(line) ^ (uint64_t)size;
+  t_count_cache *entry = &count_cache[hash >> 52];
+
+  if ((entry->size == size) && bits_equal(entry->key[0], line[0]) &&
+      bits_equal(entry->key[1], line[1]))
+    return entry->count;
+
+  /* Same states as dp_completions, counted instead of reached :
+   * count[last value][run][ones]. The balanced lines of 64 cells fit in
+   * 64 bits, the longer ones saturate. */
+  int half = size / 2;
+  uint64_t count[2][3][MAX_GRID_SIZE / 2 + 1] = {0};
+
+  for (int p = 0; p < size; p++)
+  {
+    uint64_t next[2][3][MAX_GRID_SIZE / 2 + 1] = {0};
+    bool allowed[2] = {!bits_test(line[1], p), !bits_test(line[0], p)};
+
+    for (int value = 0; value < 2; value++)
+    {
+      if (!allowed[value])
+        continue;
+
+      if (p == 0)
+      {
+        next[value][1][value] = 1;
+        continue;
+      }
+
+      for (int ones = 0; ones + value <= half; ones++)
+      {
+        /* At most `half` zeros after p + 1 cells. */
+        if (p + 1 - (ones + value) > half)
+          continue;
+
+        /* A new run after the other value, a run of 2 after a run of 1. */
+        next[value][1][ones + value] =
+            saturated_add(next[value][1][ones + value],
+                          saturated_add(count[!value][1][ones],
+                                        count[!value][2][ones]));
+        next[value][2][ones + value] = saturated_add(
+            next[value][2][ones + value], count[value][1][ones]);
+      }
+    }
+
+    memcpy(count, next, sizeof(count));
+  }
+
+  uint64_t total = 0;
+  for (int value = 0; value < 2; value++)
+    total = saturated_add(
+        total, saturated_add(count[value][1][half], count[value][2][half]));
+
+  entry->key[0] = line[0];
+  entry->key[1] = line[1];
+  entry->size = size;
+  entry->count = total;
+
+  return total;
+}
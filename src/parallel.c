@@ -0,0 +1,245 @@
+#include "parallel.h"
+
+#include <string.h>
+
+typedef struct
+{
+  t_pool *pool;
+  int id;
+  t_grid grid;
+  t_solver solver;
+  pthread_t thread;
+} t_worker;
+
+int parallel_threads(void)
+{
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (cores < 1) ? 1 : (int)cores;
+}
+
+/* The deque is a ring : task `index` is in slot index % DEQUE_CAPACITY. */
+static inline binline *deque_slot(t_pool *pool, t_deque *deque, int index)
+{
+  return deque->tasks + (size_t)(index % DEQUE_CAPACITY) * 2 * pool->size;
+}
+
+bool pool_hungry(t_pool *pool)
+{
+  return (pool->threads > 1) && (atomic_load(&pool->available) < pool->threads);
+}
+
+bool pool_share(t_pool *pool, int worker, t_grid *grid)
+{
+  t_deque *deque = &pool->deques[worker];
+
+  pthread_mutex_lock(&deque->lock);
+  if (deque->tail - deque->head == DEQUE_CAPACITY)
+  {
+    pthread_mutex_unlock(&deque->lock);
+    return false;
+  }
+
+  binline *slot = deque_slot(pool, deque, deque->tail);
+  memcpy(slot, grid->lines, grid->size * sizeof(binline));
+  memcpy(slot + grid->size, grid->columns, grid->size * sizeof(binline));
+  deque->tail++;
+  pthread_mutex_unlock(&deque->lock);
+
+  /* Counters are updated under the pool lock so that a worker going to
+   * sleep can't miss the wakeup. */
+  pthread_mutex_lock(&pool->lock);
+  atomic_fetch_add(&pool->pending, 1);
+  atomic_fetch_add(&pool->available, 1);
+  pthread_cond_signal(&pool->wakeup);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+/* Takes a task from `deque` into `grid`, the newest one if we own the
+ * deque, the oldest one if we steal it. */
+static bool deque_take(t_pool *pool, t_deque *deque, t_grid *grid, bool owner)
+{
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head == deque->tail)
+  {
+    pthread_mutex_unlock(&deque->lock);
+    return false;
+  }
+
+  int index = owner ? --deque->tail : deque->head++;
+  binline *slot = deque_slot(pool, deque, index);
+  memcpy(grid->lines, slot, grid->size * sizeof(binline));
+  memcpy(grid->columns, slot + grid->size, grid->size * sizeof(binline));
+  grid_mark_dirty(grid);
+
+  /* The slots stay the same when both ends move by a whole ring. */
+  if (deque->head == deque->tail)
+  {
+    deque->head = 0;
+    deque->tail = 0;
+  }
+  else if (deque->head >= DEQUE_CAPACITY)
+  {
+    deque->head -= DEQUE_CAPACITY;
+    deque->tail -= DEQUE_CAPACITY;
+  }
+  pthread_mutex_unlock(&deque->lock);
+
+  atomic_fetch_sub(&pool->available, 1);
+  return true;
+}
+
+static bool pool_take(t_pool *pool, int worker, t_grid *grid)
+{
+  if (deque_take(pool, &pool->deques[worker], grid, true))
+    return true;
+
+  for (int i = 1; i < pool->threads; i++)
+  {
+    int victim = (worker + i) % pool->threads;
+    if (deque_take(pool, &pool->deques[victim], grid, false))
+      return true;
+  }
+
+  return false;
+}
+
+static void *worker_run(void *arg)
+{
+  t_worker *worker = arg;
+  t_pool *pool = worker->pool;
+
+  while (true)
+  {
+    if (!pool_take(pool, worker->id, &worker->grid))
+    {
+      pthread_mutex_lock(&pool->lock);
+      while (atomic_load(&pool->pending) > 0 &&
+             atomic_load(&pool->available) == 0)
+        pthread_cond_wait(&pool->wakeup, &pool->lock);
+
+      bool done = (atomic_load(&pool->pending) == 0);
+      pthread_mutex_unlock(&pool->lock);
+
+      if (done)
+        break;
+      continue;
+    }
+
+    trail_solver(&worker->solver, &worker->grid);
+
+    pthread_mutex_lock(&pool->lock);
+    if (atomic_fetch_sub(&pool->pending, 1) == 1)
+      pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+bool parallel_count(t_grid *grid, int threads, branching_t branching,
+                    bool probing, t_stats *stats)
+{
+  if (threads < 1)
+    threads = 1;
+
+  t_pool pool;
+  pool.size = grid->size;
+  pool.threads = threads;
+  atomic_init(&pool.pending, 0);
+  atomic_init(&pool.available, 0);
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.wakeup, NULL);
+
+  /* The grids of the workers start on cache lines. */
+  t_worker *workers = aligned_alloc(GRID_ALIGNMENT, threads * sizeof(t_worker));
+  pool.deques = calloc(threads, sizeof(t_deque));
+  if (workers == NULL || pool.deques == NULL)
+  {
+    warnx("error: workers calloc");
+    free(workers);
+    free(pool.deques);
+    return false;
+  }
+
+  /* Workers are initialized in order until one fails : only the
+   * `initialized` first ones have a solver to sum and to free. */
+  int initialized = 0;
+  for (int i = 0; i < threads; i++)
+  {
+    t_deque *deque = &pool.deques[i];
+    deque->tasks = calloc((size_t)DEQUE_CAPACITY * 2 * grid->size,
+                          sizeof(binline));
+    pthread_mutex_init(&deque->lock, NULL);
+
+    workers[i].pool = &pool;
+    workers[i].id = i;
+    grid_init(&workers[i].grid, grid->size);
+
+    /* A failed solver_init frees what it allocated. */
+    if (initialized < i || deque->tasks == NULL ||
+        !solver_init(&workers[i].solver, grid, NULL, MODE_ALL, false))
+      continue;
+    initialized++;
+
+    workers[i].solver.pool = &pool;
+    workers[i].solver.worker = i;
+    workers[i].solver.branching = branching;
+    workers[i].solver.probing = probing;
+  }
+
+  bool ok = (initialized == threads);
+  if (ok)
+  {
+    /* The whole grid is the first task. */
+    pool_share(&pool, 0, grid);
+
+    for (int i = 0; i < threads; i++)
+      pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+
+    for (int i = 0; i < threads; i++)
+      pthread_join(workers[i].thread, NULL);
+  }
+
+  stats->solutions = 0;
+  stats->backtracks = 0;
+  stats->nodes = 0;
+  stats->allocations = 0;
+  memset(&stats->rules, 0, sizeof(t_rule_stats));
+  stats->probes = 0;
+  stats->fixes = 0;
+  stats->probe_time = 0;
+  stats->solved = false;
+
+  for (int i = 0; i < initialized; i++)
+  {
+    stats->solutions += workers[i].solver.stats.solutions;
+    stats->backtracks += workers[i].solver.stats.backtracks;
+    stats->nodes += workers[i].solver.stats.nodes;
+    stats->allocations += workers[i].solver.stats.allocations;
+    stats->probes += workers[i].solver.stats.probes;
+    stats->fixes += workers[i].solver.stats.fixes;
+    stats->probe_time += workers[i].solver.stats.probe_time;
+    for (int r = 0; r < RULE_COUNT; r++)
+    {
+      stats->rules.visits[r] += workers[i].solver.stats.rules.visits[r];
+      stats->rules.forced[r] += workers[i].solver.stats.rules.forced[r];
+    }
+    stats->solved = stats->solved || workers[i].solver.stats.solved;
+    solver_free(&workers[i].solver);
+  }
+
+  for (int i = 0; i < threads; i++)
+  {
+    free(pool.deques[i].tasks);
+    pthread_mutex_destroy(&pool.deques[i].lock);
+  }
+
+  free(workers);
+  free(pool.deques);
+  pthread_mutex_destroy(&pool.lock);
+  pthread_cond_destroy(&pool.wakeup);
+
+  return ok;
+}
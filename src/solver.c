@@ -0,0 +1,354 @@
+#include "solver.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <parallel.h>
+
+bool trail_allocate(t_trail *trail, t_grid *grid)
+{
+  int empty_cells = 0;
+  for (int i = 0; i < grid->size; i++)
+  {
+    for (int j = 0; j < grid->size; j++)
+    {
+      if (get_cell(i, j, grid) == EMPTY_CELL)
+        empty_cells++;
+    }
+  }
+
+  trail->size = grid->size;
+  trail->depth = 0;
+  trail->capacity = empty_cells + 1;
+
+  /* A snapshot is made of the `size` lines followed by the `size` columns. */
+  trail->snapshots = calloc((size_t)trail->capacity * 2 * grid->size,
+                            sizeof(binline));
+  trail->counts = calloc((size_t)trail->capacity * 2 * grid->size,
+                         sizeof(*trail->counts));
+  if (trail->snapshots == NULL || trail->counts == NULL)
+  {
+    warnx("error: trail calloc");
+    free(trail->snapshots);
+    free(trail->counts);
+    trail->snapshots = NULL;
+    trail->counts = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void trail_free(t_trail *trail)
+{
+  if (trail == NULL)
+    return;
+
+  free(trail->snapshots);
+  free(trail->counts);
+  trail->snapshots = NULL;
+  trail->counts = NULL;
+}
+
+static inline void trail_push(t_trail *trail, t_grid *grid)
+{
+  if (trail->depth == trail->capacity)
+    errx(EXIT_FAILURE, "error: trail overflow");
+
+  size_t offset = (size_t)trail->depth * 2 * trail->size;
+  binline *snapshot = trail->snapshots + offset;
+  memcpy(snapshot, grid->lines, grid->size * sizeof(binline));
+  memcpy(snapshot + grid->size, grid->columns, grid->size * sizeof(binline));
+
+  uint16_t(*counts)[2] = trail->counts + offset;
+  memcpy(counts, grid->counts[LINE], grid->size * sizeof(*counts));
+  memcpy(counts + grid->size, grid->counts[COLUMN],
+         grid->size * sizeof(*counts));
+  trail->depth++;
+}
+
+/* Restores the last snapshot without removing it from the trail, the
+ * second choice of a branch starts from the same state as the first.
+ * Snapshots are taken on grids which passed the heuristics, nothing is left
+ * to check. */
+static inline void trail_restore(t_trail *trail, t_grid *grid)
+{
+  size_t offset = (size_t)(trail->depth - 1) * 2 * trail->size;
+  binline *snapshot = trail->snapshots + offset;
+  memcpy(grid->lines, snapshot, grid->size * sizeof(binline));
+  memcpy(grid->columns, snapshot + grid->size, grid->size * sizeof(binline));
+
+  uint16_t(*counts)[2] = trail->counts + offset;
+  memcpy(grid->counts[LINE], counts, grid->size * sizeof(*counts));
+  memcpy(grid->counts[COLUMN], counts + grid->size,
+         grid->size * sizeof(*counts));
+  grid->dirty[LINE] = bits_zero();
+  grid->dirty[COLUMN] = bits_zero();
+  grid->queue[LINE] = bits_zero();
+  grid->queue[COLUMN] = bits_zero();
+}
+
+static inline void trail_pop(t_trail *trail)
+{
+  trail->depth--;
+}
+
+bool solver_init(t_solver *solver, t_grid *grid, FILE *fd, const mode_t mode,
+                 bool verbose)
+{
+  solver->mode = mode;
+  solver->fd = fd;
+  solver->verbose = verbose;
+  solver->stats.solutions = 0;
+  solver->stats.backtracks = 0;
+  solver->stats.nodes = 0;
+  solver->stats.allocations = 0;
+  memset(&solver->stats.rules, 0, sizeof(t_rule_stats));
+  solver->stats.probes = 0;
+  solver->stats.fixes = 0;
+  solver->stats.probe_time = 0;
+  solver->stats.memo_hits = 0;
+  solver->stats.solved = false;
+  solver->max_nodes = 0;
+  solver->hint = NULL;
+  solver->max_solutions = 0;
+  solver->pool = NULL;
+  solver->worker = 0;
+  solver->heuristics = grid_heuristics_kernel(grid->size);
+  solver->branching = BRANCH_FILLED;
+  solver->probing = false;
+
+  return trail_allocate(&solver->trail, grid);
+}
+
+void solver_free(t_solver *solver)
+{
+  trail_free(&solver->trail);
+}
+
+/* Wall clock time in seconds. */
+static double now(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Failed-literal probing : each value of each empty cell is tried on the
+ * scratch grid, a value the heuristics refute can't be in any solution of
+ * the subtree and the cell gets the other one. Fixed cells are written in
+ * `grid` and so kept by the whole subtree, the trail drops them on
+ * backtrack. Returns false if `grid` turns out inconsistent. */
+static bool probe(t_solver *solver, t_grid *grid)
+{
+  t_bits full_line = bits_full(grid->size);
+  double start = now();
+  bool consistent = true;
+  bool fixed = true;
+
+  while (consistent && fixed && !is_full(grid))
+  {
+    fixed = false;
+
+    /* Values implied by a probe which succeeded would succeed too, they
+     * aren't probed until the grid changes. */
+    binline implied[MAX_GRID_SIZE];
+    memset(implied, 0, sizeof(implied));
+
+    for (int i = 0; consistent && i < grid->size; i++)
+    {
+      t_bits empty = bits_andnot(full_line,
+                                 bits_or(grid->lines[i][0], grid->lines[i][1]));
+
+      while (consistent && bits_any(empty))
+      {
+        int j = bits_pop(&empty);
+        if (bits_test(bits_or(grid->lines[i][0], grid->lines[i][1]), j))
+          continue; /* Filled by an earlier fix. */
+
+        for (int value = 0; value < 2; value++)
+        {
+          if (bits_test(implied[i][value], j))
+            continue;
+
+          choice_t choice = {i, j, value + ZERO};
+          solver->stats.probes++;
+          grid_copy(grid, &solver->scratch);
+          grid_choice_apply(&solver->scratch, choice);
+
+          if (solver->heuristics(&solver->scratch))
+          {
+            for (int k = 0; k < grid->size; k++)
+            {
+              implied[k][0] =
+                  bits_or(implied[k][0], solver->scratch.lines[k][0]);
+              implied[k][1] =
+                  bits_or(implied[k][1], solver->scratch.lines[k][1]);
+            }
+            continue;
+          }
+
+          solver->stats.fixes++;
+          grid_choice_apply_opposite(grid, choice);
+          consistent = solver->heuristics(grid);
+          memset(implied, 0, sizeof(implied));
+          fixed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  solver->stats.probe_time += now() - start;
+  return consistent;
+}
+
+static bool trail_search(t_solver *solver, t_grid *grid)
+{
+  if (solver->max_nodes && solver->stats.nodes >= solver->max_nodes)
+    return false;
+  if (solver->max_solutions &&
+      solver->stats.solutions >= solver->max_solutions)
+    return false;
+  solver->stats.nodes++;
+
+  if (!solver->heuristics(grid))
+    return false;
+
+  if (solver->probing && !is_full(grid) && !probe(solver, grid))
+    return false;
+
+  if (is_full(grid))
+  {
+    if (solver->fd)
+      fprintf(solver->fd, "\nSolution ");
+
+    if (solver->mode)
+    {
+      solver->stats.solutions++;
+      if (solver->fd)
+        fprintf(solver->fd, "%ld:", solver->stats.solutions);
+    }
+
+    if (solver->fd)
+    {
+      fprintf(solver->fd, "\n");
+      grid_print(grid, solver->fd);
+    }
+
+    solver->stats.solved = true;
+    return true;
+  }
+
+  choice_t choice =
+      branching_choice(grid, solver->branching, &solver->scratch);
+  if (solver->verbose && solver->fd)
+    grid_choice_print(choice, solver->fd);
+
+  trail_push(&solver->trail, grid);
+
+  /* When other workers are starving, the opposite choice is given away as
+   * a task instead of being explored here. */
+  bool shared = false;
+  if (solver->pool && pool_hungry(solver->pool))
+  {
+    grid_choice_apply_opposite(grid, choice);
+    shared = pool_share(solver->pool, solver->worker, grid);
+    trail_restore(&solver->trail, grid);
+  }
+
+  grid_choice_apply(grid, choice);
+
+  bool found = trail_search(solver, grid);
+  if (found && !solver->mode)
+  {
+    /* Keep the solution in `grid`, the snapshot isn't needed anymore. */
+    trail_pop(&solver->trail);
+    return true;
+  }
+
+  trail_restore(&solver->trail, grid);
+  trail_pop(&solver->trail);
+
+  /* The worker which takes the opposite choice counts its own work, only
+   * the explored choice is known here. */
+  if (shared)
+  {
+    if (!found)
+      solver->stats.backtracks++;
+    return found;
+  }
+
+  grid_choice_apply_opposite(grid, choice);
+  if (!trail_search(solver, grid))
+  {
+    /* Neither choices ends up in a consistent grid, we go up. */
+    solver->stats.backtracks++;
+    return false;
+  }
+
+  return true;
+}
+
+bool trail_solver(t_solver *solver, t_grid *grid)
+{
+  size_t allocations = grid_allocations();
+
+  t_rule_stats before, after;
+  rule_stats_get(&before);
+
+  bool result = trail_search(solver, grid);
+
+  solver->stats.allocations += grid_allocations() - allocations;
+  rule_stats_get(&after);
+  for (int r = 0; r < RULE_COUNT; r++)
+  {
+    solver->stats.rules.visits[r] += after.visits[r] - before.visits[r];
+    solver->stats.rules.forced[r] += after.forced[r] - before.forced[r];
+  }
+
+  return result;
+}
+
+bool has_unique_solution(t_grid *grid)
+{
+  t_grid work;
+  grid_copy(grid, &work);
+
+  t_solver solver;
+  if (!solver_init(&solver, &work, NULL, MODE_ALL, false))
+    errx(EXIT_FAILURE, "error: can't initialize the solver");
+  solver.max_solutions = 2;
+  /* Without a second solution the whole tree is explored, the probes prune
+   * it on large grids. */
+  solver.probing = true;
+
+  trail_solver(&solver, &work);
+  bool unique = (solver.stats.solutions == 1);
+
+  solver_free(&solver);
+
+  return unique;
+}
+
+refute_t refute_cell(t_solver *solver, t_grid *work, const t_grid *puzzle,
+                     int row, int column, char value)
+{
+  grid_copy(puzzle, work);
+  set_cell(row, column, work, (value == ONE) ? ZERO : ONE);
+
+  /* Most flips are refuted by the propagation alone. */
+  if (!grid_heuristics(work))
+    return REFUTE_REFUTED;
+
+  size_t nodes = solver->stats.nodes;
+  solver->stats.nodes = 0;
+  refute_t result = REFUTE_REFUTED;
+  if (trail_solver(solver, work))
+    result = REFUTE_SOLVED;
+  else if (solver->max_nodes && solver->stats.nodes >= solver->max_nodes)
+    result = REFUTE_BUDGET;
+  solver->stats.nodes += nodes;
+
+  return result;
+}
@@ -5,208 +5,41 @@ static size_t solutions;
 static bool solved;
 static size_t backtracks;
 
-/* We need to allocate dynamically the grid ptr when it is initialized
- * locally and we want to return it to function caller. */
-static inline void free_grid_and_ptr(t_grid *grid)
-{
-  grid_free(grid);
-  if (grid->onHeap)
-  {
-    free(grid);
-  }
-}
-
-/* This function fills the grid starting from the 2nd line. */
-static bool fill_grid(t_grid *grid, int size, int *current_ptr,
-                      FILE *parsing_file, int *row, int *col)
-{
-  while (*current_ptr != EOF)
-  {
-    /* Ignore comment line. */
-    if (*current_ptr == '#')
-    {
-      while (!(*current_ptr == '\n' || *current_ptr == EOF))
-      {
-        *current_ptr = fgetc(parsing_file);
-      }
-    }
-
-    /* End of line. */
-    else if (*current_ptr == '\n')
-    {
-      if (*col != 0)
-      {
-        if (*col != size)
-        {
-          warnx("error: wrong number of character at line %d!", *row + 1);
-          return false;
-        }
-        *col = 0;
-        (*row)++;
-      }
-    }
-
-    /* Significant line : fill grid. */
-    else if (*current_ptr != ' ' && *current_ptr != '\t' &&
-             *current_ptr != EOF)
-    {
-      if (!check_char(grid, *current_ptr))
-      {
-        warnx("error: wrong character '%c' at line %d!", *current_ptr,
-              *row + 1);
-        return false;
-      }
-
-      if (*row >= size)
-      {
-        warnx("error: grid has too many lines");
-        return false;
-      }
-      set_cell(*row, *col, grid, *current_ptr);
-      (*col)++;
-    }
-
-    *current_ptr = fgetc(parsing_file);
-  } /* current_char = EOF. */
-
-  return true;
-}
-
-/* Opens the given file and detects when is the grid starting :
- * ignore comments and empty lines.
- * Fills the first grid with the first line of the file and checks if the
- * size of the line is a correct one, if yes fills the rest of the grid and
- * checks subsiding errors : wrong character, wrong number of characters.. */
-static t_grid *file_parser(char *filename)
-{
-  FILE *parsing_file = NULL;
-  t_grid g;
-
-  parsing_file = fopen(filename, "r");
-  if (parsing_file == NULL)
-  {
-    warnx("error : can't open !file %s", filename);
-    goto error;
-  }
-
-  int current_char;
-
-  /* Deciding when is starting the first row (not counting comments). */
-  do
-  {
-    current_char = fgetc(parsing_file);
-
-    if (current_char == '#')
-      while (current_char != '\n' && current_char != EOF)
-        current_char = fgetc(parsing_file);
-
-    if (current_char == EOF)
-    {
-      warnx("error: EOF at beginning of the file %s", filename);
-      goto error;
-    }
-
-  } while (current_char == '\t' || current_char == '\n' ||
-           current_char == ' ' || current_char == '#');
-
-  char line[MAX_GRID_SIZE];
-  line[0] = current_char;
-  int size = 1;
-  current_char = fgetc(parsing_file);
-
-  /* Fill `line` with first significant (not comments) line of the file. */
-  while (current_char != EOF && current_char != '\n')
-  {
-    if (current_char != ' ' && current_char != '\t')
-    {
-      if (size == 64)
-      {
-        warnx("error: first line size in file %s is too long", filename);
-        goto error;
-      }
-      line[size] = current_char;
-      size++;
-    }
-    current_char = fgetc(parsing_file);
-  } /* `current_char` = EOF or '\n'. */
-
-  if (!check_size(size))
-  {
-    warnx("error: wrong line size in file %s", filename);
-    goto error;
-  }
-
-  grid_allocate(&g, size);
-  t_grid *grid = &g;
-
-  int row = 0;
-  int col;
-
-  /* Initialize first row of grid. */
-  for (col = 0; col < size; col++)
-  {
-    if (!check_char(grid, line[col]))
-    {
-      warnx("error: wrong character '%c' at line 1!", line[col]);
-      goto error;
-    }
-    set_cell(row, col, grid, line[col]);
-  }
-
-  row++;
-  col = 0;
-  current_char = fgetc(parsing_file);
-
-  if (!fill_grid(grid, size, &current_char, parsing_file, &row, &col))
-    goto error;
-
-  /* `current_char` = EOF, check any subsiding error case. */
-
-  if (col != 0) /* EOF found before '\n'. */
-  {
-    if (col != size)
-    {
-      warnx("error: line %d is malformed! (wrong number of cols)",
-            row + 1);
-      goto error;
-    }
-    col = 0;
-    row++;
-  }
-
-  if (row != size)
-  {
-    warnx("error: grid has wrong number of lines");
-    goto error;
-  }
-
-  fclose(parsing_file);
-  return grid;
-
-/* I justify the use of goto because there are a lot of error possibily
- * to avoid code redundancy. */
-error:
-
-  if (grid != NULL)
-    grid_free(grid);
-
-  if (parsing_file != NULL)
-    fclose(parsing_file);
-
-  return NULL;
-}
-
 static void print_help()
 {
-  printf("Usage: takuzu [-a|-o FILE|-v|-h] FILE...\n"
-         "       takuzu -g[SIZE] [-u|-o FILE|-v|-h]\n"
-         "Solve or generate takuzu grids of size:(4, 8, 16, 32, 64)\n\n"
+  printf("Usage: takuzu [-a|-c|-j[N]|-e ENGINE|-b STRATEGY|-p|-o FILE|-v|-h] "
+         "FILE...\n"
+         "       takuzu -g[SIZE] [-u|-d LEVEL|-m|-n COUNT|-j[N]|-s SEED|-o FILE|-v|"
+         "-h]\n"
+         "Solve or generate takuzu grids of size:(4, 8, 16, ..., %d)\n\n"
          "-a, --all               search for all possible solutions\n"
+         "-c, --count             count the solutions without printing them\n"
+         "-j[N], --jobs[=N]       count solutions of '-a', generate the grids\n"
+         "                        of '-n' or minimize the grid of '-m' with N\n"
+         "                        threads (default: number of cores)\n"
+         "-e ENGINE, --engine ENGINE\n"
+         "                        solver engine: trail (default), copy or cdcl\n"
+         "-b STRATEGY, --branching STRATEGY\n"
+         "                        choice of the next cell of the trail engine:\n"
+         "                        filled (default), balance, constrained or\n"
+         "                        lookahead\n"
+         "-p, --probe             probe the cells before each choice of the\n"
+         "                        trail engine\n"
          "-g[N], --generate[N]    generate a grid of size NxN (default:8)\n"
          "-u, --unique            generate a grid with unique solution\n"
+         "-d LEVEL, --difficulty LEVEL\n"
+         "                        generate a grid with unique solution of\n"
+         "                        difficulty easy, medium, hard or expert\n"
+         "-m, --minimize          remove every clue the unique solution\n"
+         "                        doesn't need\n"
+         "-n COUNT, --batch COUNT generate COUNT grids with the threads of\n"
+         "                        '-j' (default: number of cores)\n"
+         "-s SEED, --seed SEED    master seed of the generator (default:\n"
+         "                        changes on each run)\n"
          "-o FILE, --output FILE  write output to FILE\n"
          "-v, --verbose           verbose output\n"
-         "-h, --help              display this help and exit\n");
+         "-h, --help              display this help and exit\n",
+         MAX_GRID_SIZE);
 }
 
 /* Applies heuristics to the given grid and from then :
@@ -220,7 +53,7 @@ t_grid *grid_solver(t_grid *grid, FILE *fd, const mode_t mode, bool solver)
 {
   if (!grid_heuristics(grid))
   {
-    free_grid_and_ptr(grid);
+    free(grid);
     return NULL;
   } /* `grid` is consistent. */
 
@@ -248,7 +81,7 @@ t_grid *grid_solver(t_grid *grid, FILE *fd, const mode_t mode, bool solver)
     return grid;
   }
 
-  t_grid *copy = malloc(sizeof(t_grid));
+  t_grid *copy = grid_new(grid->size);
   if (copy == NULL)
   {
     fprintf(fd, "error copy malloc in grid_solver.");
@@ -256,7 +89,6 @@ t_grid *grid_solver(t_grid *grid, FILE *fd, const mode_t mode, bool solver)
   }
 
   grid_copy(grid, copy);
-  copy->onHeap = 1;
 
   choice_t choice = grid_choice(grid);
   if (verbose && solver)
@@ -266,13 +98,11 @@ t_grid *grid_solver(t_grid *grid, FILE *fd, const mode_t mode, bool solver)
 
   if (copy && !mode)
   {
-    free_grid_and_ptr(grid);
+    free(grid);
     return copy;
   } /* `copy` = NULL or mode = MODE_ALL */
 
-  grid_free(copy);
   free(copy);
-  /* No need to check onHeap because we know for sure copy is malloc'd. */
 
   grid_choice_apply_opposite(grid, choice);
   grid = grid_solver(grid, fd, mode, solver);
@@ -286,224 +116,22 @@ t_grid *grid_solver(t_grid *grid, FILE *fd, const mode_t mode, bool solver)
   return grid;
 }
 
-/* Generates a grid by filling an outer ring and calling solver on it.*/
-static t_grid *grid_generate(int size, FILE *fd)
-{
-
-  t_grid *grid = malloc(sizeof(t_grid));
-  if (!grid)
-  {
-    fprintf(fd, "error generate_1 malloc");
-    return NULL;
-  }
-
-  while (true)
-  {
-    grid_allocate(grid, size);
-    grid->onHeap = 1;
-
-    grid_outer_ring(grid);
-
-    if (is_consistent(grid))
-    {
-      break;
-    }
-    grid_free(grid);
-  } /* `grid` is consistent. */
-
-  if (size > MIN_GRID_SIZE)
-    grid = grid_solver(grid, fd, MODE_FIRST, GEN_MODE);
-
-  return grid;
-}
-
-/* Generates grids of size 8+ by putting together 4 subgrids of
- * half the size. */
-static t_grid *grid_assemble(int size, FILE *fd)
-{
-  if (size == DEFAULT_SIZE)
-  {
-    while (true)
-    {
-      int halfsize = MIN_GRID_SIZE;
-      t_grid *grid = malloc(sizeof(t_grid));
-      if (!grid)
-      {
-        fprintf(fd, "error generate_1 malloc");
-        return NULL;
-      }
-      grid_allocate(grid, size);
-      grid->onHeap = 1;
-
-      t_grid *grid1 = grid_generate(halfsize, fd);
-      if (!grid1)
-        return NULL;
-      t_grid *grid2 = grid_generate(halfsize, fd);
-      if (!grid2)
-        return NULL;
-      t_grid *grid3 = grid_generate(halfsize, fd);
-      if (!grid3)
-        return NULL;
-      t_grid *grid4 = grid_generate(halfsize, fd);
-      if (!grid4)
-        return NULL;
-
-      for (int i = 0; i < halfsize; i++)
-      {
-        for (int j = 0; j < halfsize; j++)
-        {
-          set_cell(i, j, grid, get_cell(i, j, grid1));
-          set_cell(i, j + halfsize, grid, get_cell(i, j, grid2));
-          set_cell(i + halfsize, j, grid, get_cell(i, j, grid3));
-          set_cell(i + halfsize, j + halfsize, grid, get_cell(i, j, grid4));
-        }
-      }
-
-      free_grid_and_ptr(grid1);
-      free_grid_and_ptr(grid2);
-      free_grid_and_ptr(grid3);
-      free_grid_and_ptr(grid4);
-
-      if (is_consistent(grid))
-        return grid;
-
-      /* Free grid only if we need to generate a new one. */
-      free_grid_and_ptr(grid);
-    }
-  }
-
-  else /* size != 8. */
-  {
-    while (true)
-    {
-      int halfsize = size / 2;
-      t_grid *grid = malloc(sizeof(t_grid));
-      if (!grid)
-      {
-        fprintf(fd, "error generate_1 malloc");
-        return NULL;
-      }
-      grid_allocate(grid, size);
-      grid->onHeap = 1;
-
-      t_grid *grid1 = grid_assemble(halfsize, fd);
-      if (!grid1)
-        return NULL;
-      t_grid *grid2 = grid_assemble(halfsize, fd);
-      if (!grid2)
-        return NULL;
-      t_grid *grid3 = grid_assemble(halfsize, fd);
-      if (!grid3)
-        return NULL;
-      t_grid *grid4 = grid_assemble(halfsize, fd);
-      if (!grid4)
-        return NULL;
-
-      for (int i = 0; i < halfsize; i++)
-      {
-        for (int j = 0; j < halfsize; j++)
-        {
-          set_cell(i, j, grid, get_cell(i, j, grid1));
-          set_cell(i, j + halfsize, grid, get_cell(i, j, grid2));
-          set_cell(i + halfsize, j, grid, get_cell(i, j, grid3));
-          set_cell(i + halfsize, j + halfsize, grid, get_cell(i, j, grid4));
-        }
-      }
-
-      free_grid_and_ptr(grid1);
-      free_grid_and_ptr(grid2);
-      free_grid_and_ptr(grid3);
-      free_grid_and_ptr(grid4);
-
-      if (is_consistent(grid))
-        return grid;
-
-      free_grid_and_ptr(grid);
-    }
-  }
-}
-
-/* Once grids are generated, call this function to remove a number
- * of cells determined by the N defined in takuzu.h */
-static bool grid_remove_cells(t_grid *grid, bool unique)
-{
-  /* Tab of randomized indexes of the grid */
-  int square_size = grid->size * grid->size;
-  int index_tab[square_size];
-  for (int i = 0; i < square_size; i++)
-    index_tab[i] = i;
-
-  int j, temp;
-  for (int i = 0; i < square_size; i++)
-  {
-    j = i + rand() % (square_size - i);
-    temp = index_tab[i];
-    index_tab[i] = index_tab[j];
-    index_tab[j] = temp;
-  }
-
-  if (unique)
-  {
-    int nb_to_remove = square_size - (int)(N * square_size);
-    int i = 0;
-    int nb_removed = 0;
-
-    while ((nb_removed < nb_to_remove) && (i < square_size))
-    {
-      solutions = 0;
-
-      t_grid *copy = malloc(sizeof(t_grid));
-      if (copy == NULL)
-      {
-        printf("error copy remove_cells");
-        return NULL;
-      }
-      grid_copy(grid, copy);
-      copy->onHeap = 1;
-
-      set_cell(index_tab[i] / grid->size, index_tab[i] % grid->size,
-               copy, EMPTY_CELL);
-      copy = grid_solver(copy, stdout, MODE_ALL, GEN_MODE);
-
-      i++;
-      if (copy)
-      {
-        free_grid_and_ptr(copy);
-      } /* `copy` can be NULL in case last explored grid was unconsistent. */
-
-      if (solutions > 1)
-      {
-        continue;
-      }
-      /* unique solution => we remove cell in the original grid. */
-      set_cell(index_tab[i] / grid->size, index_tab[i] % grid->size,
-               grid, EMPTY_CELL);
-      nb_removed++;
-    }
-
-    return (i < square_size);
-  }
-  /* Not unique generation. */
-  else
-  {
-    int nb_to_remove = square_size - (int)(N * square_size);
-    for (int i = 0; i < nb_to_remove; i++)
-    {
-      set_cell(index_tab[i] / grid->size, index_tab[i] % grid->size,
-               grid, EMPTY_CELL);
-    }
-
-    return true;
-  }
-}
-
 int main(int argc, char *argv[])
 {
   const struct option long_opts[] =
       {
           {"all", no_argument, NULL, 'a'},
+          {"count", no_argument, NULL, 'c'},
+          {"jobs", optional_argument, NULL, 'j'},
+          {"engine", required_argument, NULL, 'e'},
+          {"branching", required_argument, NULL, 'b'},
+          {"probe", no_argument, NULL, 'p'},
           {"generate", optional_argument, NULL, 'g'},
           {"unique", no_argument, NULL, 'u'},
+          {"difficulty", required_argument, NULL, 'd'},
+          {"minimize", no_argument, NULL, 'm'},
+          {"batch", required_argument, NULL, 'n'},
+          {"seed", required_argument, NULL, 's'},
           {"output", required_argument, NULL, 'o'},
           {"verbose", no_argument, NULL, 'v'},
           {"help", no_argument, NULL, 'h'},
@@ -512,15 +140,24 @@ int main(int argc, char *argv[])
   bool unique = false;
   bool generator = false; /* true = generator , false = solver */
   mode_t mode = MODE_FIRST;
+  bool counting = false;
+  engine_t engine = ENGINE_TRAIL;
+  branching_t branching = BRANCH_FILLED;
+  bool probing = false;
+  int threads = 0; /* 0 = no parallel counting. */
   FILE *file = stdout;
   char *output_file = NULL;
   int size = DEFAULT_SIZE;
+  difficulty_t difficulty = DIFFICULTY_NONE;
+  bool minimize = false;
+  size_t batch = 0; /* 0 = a single grid. */
+  uint64_t seed = rng_entropy();
   clock_t start = 0;
   clock_t end = 0;
 
   int optc;
 
-  while ((optc = getopt_long(argc, argv, "ag::uo:vh", long_opts, NULL)) != -1)
+  while ((optc = getopt_long(argc, argv, "acj::e:b:pg::ud:mn:s:o:vh", long_opts, NULL)) != -1)
     switch (optc)
     {
     case 'a':
@@ -533,6 +170,52 @@ int main(int argc, char *argv[])
       mode = MODE_ALL;
       break;
 
+    case 'c':
+      if (generator)
+      {
+        warnx("warning: option 'count' conflicts with generator mode, "
+              "disabling it!");
+        generator = false;
+      }
+      mode = MODE_ALL;
+      counting = true;
+      break;
+
+    case 'j':
+      threads = parallel_threads();
+      if (optarg != NULL)
+      {
+        threads = strtol(optarg, NULL, 10);
+        if (threads < 1)
+          errx(EXIT_FAILURE, "error: you must enter a positive number of "
+                             "threads");
+      }
+      break;
+
+    case 'e':
+      if (strcmp(optarg, "trail") == 0)
+        engine = ENGINE_TRAIL;
+      else if (strcmp(optarg, "copy") == 0)
+        engine = ENGINE_COPY;
+      else if (strcmp(optarg, "cdcl") == 0)
+        engine = ENGINE_CDCL;
+      else
+        errx(EXIT_FAILURE, "error: unknown engine '%s' (trail, copy, cdcl)",
+             optarg);
+      break;
+
+    case 'b':
+      branching = branching_from_name(optarg);
+      if (branching == BRANCH_COUNT)
+        errx(EXIT_FAILURE, "error: unknown branching '%s' (filled, balance, "
+                           "constrained, lookahead)",
+             optarg);
+      break;
+
+    case 'p':
+      probing = true;
+      break;
+
     case 'g':
       if (mode)
         warnx("warning: option 'all' conflicts with generator mode, disabling "
@@ -542,8 +225,8 @@ int main(int argc, char *argv[])
       {
         int grid_size = strtol(optarg, NULL, 10);
         if (!check_size(grid_size))
-          errx(EXIT_FAILURE, "error: you must enter size in (4, 8, 16, 32,"
-                             " 64)");
+          errx(EXIT_FAILURE, "error: you must enter a power of 2 size from "
+                             "%d to %d", MIN_GRID_SIZE, MAX_GRID_SIZE);
         size = grid_size;
       }
       break;
@@ -558,6 +241,46 @@ int main(int argc, char *argv[])
       unique = true;
       break;
 
+    case 'd':
+      difficulty = difficulty_from_name(optarg);
+      if (difficulty == DIFFICULTY_COUNT)
+        errx(EXIT_FAILURE, "error: unknown difficulty '%s' (easy, medium, "
+                           "hard, expert)",
+             optarg);
+      if (!generator)
+      {
+        warnx("warning: option 'difficulty' conflicts with solver mode, "
+              "disabling it!");
+        generator = true;
+      }
+      unique = true;
+      break;
+
+    case 'm':
+      if (!generator)
+      {
+        warnx("warning: option 'minimize' conflicts with solver mode, "
+              "disabling it!");
+        generator = true;
+      }
+      unique = true;
+      minimize = true;
+      break;
+
+    case 'n':
+    {
+      long long count = strtoll(optarg, NULL, 10);
+      if (count < 1)
+        errx(EXIT_FAILURE, "error: you must enter a positive number of "
+                           "grids");
+      batch = count;
+      break;
+    }
+
+    case 's':
+      seed = strtoull(optarg, NULL, 10);
+      break;
+
     case 'o':
       if (optarg == NULL)
         errx(EXIT_FAILURE, "error : no output file given");
@@ -588,6 +311,65 @@ int main(int argc, char *argv[])
       errx(EXIT_FAILURE, "error : can't create file");
   }
 
+  if (branching != BRANCH_FILLED && engine != ENGINE_TRAIL)
+  {
+    warnx("warning: option 'branching' only applies to the trail engine, "
+          "disabling it!");
+    branching = BRANCH_FILLED;
+  }
+
+  if (probing && engine != ENGINE_TRAIL)
+  {
+    warnx("warning: option 'probe' only applies to the trail engine, "
+          "disabling it!");
+    probing = false;
+  }
+
+  if (batch && !generator)
+  {
+    warnx("warning: option 'batch' only applies to generator mode, "
+          "disabling it!");
+    batch = 0;
+  }
+
+  if (minimize && difficulty != DIFFICULTY_NONE)
+  {
+    warnx("warning: option 'minimize' conflicts with option 'difficulty', "
+          "disabling it!");
+    minimize = false;
+  }
+
+  if (generator && (batch || minimize) && !threads)
+    threads = parallel_threads();
+
+  if (generator && threads && !batch && !minimize)
+  {
+    warnx("warning: option 'jobs' only applies with options 'batch' and "
+          "'minimize', disabling it!");
+    threads = 0;
+  }
+
+  if (threads && counting)
+  {
+    warnx("warning: option 'jobs' doesn't apply to option 'count', disabling "
+          "it!");
+    threads = 0;
+  }
+
+  if (threads && engine == ENGINE_CDCL)
+  {
+    warnx("warning: option 'jobs' only applies to the trail engine, "
+          "disabling it!");
+    threads = 0;
+  }
+
+  if (threads && !mode && !generator)
+  {
+    warnx("warning: option 'jobs' only applies with option 'all', disabling "
+          "it!");
+    threads = 0;
+  }
+
   /* solver mode */
   if (!generator)
   {
@@ -626,10 +408,71 @@ int main(int argc, char *argv[])
         solved = false;
         solutions = 0;
         backtracks = 0;
+        size_t allocations = grid_allocations();
+        t_stats stats = {0};
+
+        if (counting)
+        {
+          start = clock();
+          if (grid->size <= COUNT_MAX_SIZE)
+            count_solutions(grid, &stats);
+          else
+          {
+            warnx("warning: option 'count' handles grids up to %d, counting "
+                  "with the search",
+                  COUNT_MAX_SIZE);
+            if (!parallel_count(grid, 1, branching, probing, &stats))
+              errx(EXIT_FAILURE, "error: can't start the workers");
+          }
+          end = clock();
+          solutions = stats.solutions;
+        }
+        else if (threads)
+        {
+          /* Solutions are only counted, workers don't print them. */
+          if (!parallel_count(grid, threads, branching, probing, &stats))
+            errx(EXIT_FAILURE, "error: can't start the workers");
+
+          solved = stats.solved;
+          solutions = stats.solutions;
+          backtracks = stats.backtracks;
+        }
+        else if (engine == ENGINE_COPY)
+        {
+          grid = grid_solver(grid, file, mode, SOL_MODE);
+        }
+        else
+        {
+          t_solver solver;
+          if (!solver_init(&solver, grid, file, mode, verbose))
+            errx(EXIT_FAILURE, "error: can't initialize the solver");
+          solver.branching = branching;
+          solver.probing = probing;
+
+          if (engine == ENGINE_CDCL)
+            cdcl_solver(&solver, grid);
+          else
+            trail_solver(&solver, grid);
+          stats = solver.stats;
+          solved = stats.solved;
+          solutions = stats.solutions;
+          backtracks = stats.backtracks;
+          solver_free(&solver);
+        }
+
+        allocations = grid_allocations() - allocations;
 
-        grid = grid_solver(grid, file, mode, SOL_MODE);
+        if (counting)
+        {
+          double time = ((double)(end - start)) / CLOCKS_PER_SEC;
+          fprintf(file, "Number of solutions: %ld\n", solutions);
+          fprintf(file, "Elapsed time: %f seconds\n", time);
+          if (verbose)
+            fprintf(file, "Number of rows tried: %ld (%ld counts memoized)\n",
+                    stats.nodes, stats.memo_hits);
+        }
 
-        if (!solved)
+        else if (!solved)
         {
           printf("Number of solutions: 0\n");
         }
@@ -644,69 +487,75 @@ int main(int argc, char *argv[])
           if (verbose)
           {
             fprintf(file, "Number of backtracks: %ld\n", backtracks);
+            fprintf(file, "Number of allocations: %ld\n", allocations);
+            if (probing)
+              fprintf(file, "Number of probes: %ld (%ld cells fixed, %.3f s)\n",
+                      stats.probes, stats.fixes, stats.probe_time);
           }
         }
       }
 
       /* `grid` can be NULL. */
-      if (grid)
-      {
-        free_grid_and_ptr(grid);
-      }
+      free(grid);
     }
   }
 
   if (generator)
   {
-    srand(time(NULL));
+    t_gen_config config = {.size = size, .unique = unique,
+                           .difficulty = difficulty, .minimize = minimize,
+                           .threads = threads, .seed = seed};
+    if (verbose)
+      fprintf(file, "# seed %llu\n", (unsigned long long)seed);
 
-    if (size > MIN_GRID_SIZE)
+    if (batch)
     {
-      if (verbose)  start = clock();
-      while (true)
-      {
-        t_grid *grid = grid_assemble(size, file);
-
-        int i = 0;
-        while (i++ < MAX_ASSEMBLE_LOOP)
-        {
-          if (grid_remove_cells(grid, unique))
-          {
-            if (verbose)  end = clock();
-            break;
-          }
-        }
-
-        if (i < 10) /* Loop stopped because grid_remove returned true. */
-        {
-          grid_print(grid, file);
-          free_grid_and_ptr(grid);
-          if (verbose)
-          {
-            double time = ((double)(end - start)) / CLOCKS_PER_SEC;
-            fprintf(file, "Elapsed time: %f seconds\n", time);
-          }
-          break;
-        }
-
-        free_grid_and_ptr(grid);
-      }
+      struct timespec begin, finish;
+      timespec_get(&begin, TIME_UTC);
+      if (!generate_batch(&config, batch, threads, file))
+        errx(EXIT_FAILURE, "error: can't start the workers");
+      timespec_get(&finish, TIME_UTC);
+
+      double time = (finish.tv_sec - begin.tv_sec) +
+                    (finish.tv_nsec - begin.tv_nsec) / 1e9;
+      fprintf(file, "# %zu grids in %f seconds (%.1f grids/s, %d threads)\n",
+              batch, time, batch / time, threads);
     }
-    /* size = 4. */
     else
     {
       if (verbose)  start = clock();
-      t_grid *grid = grid_generate(size, file);
+      t_gen_stats stats;
+      t_grid *grid = puzzle_generate(&config, 0, &stats);
       if (verbose)  end = clock();
+      if (grid == NULL)
+        errx(EXIT_FAILURE, "error: no %s grid found in %d tries",
+             difficulty_names[difficulty], GEN_DIFFICULTY_TRIES);
 
       grid_print(grid, file);
-      free_grid_and_ptr(grid);
+      if (minimize)
+        fprintf(file, "Clues removed by the minimization: %d (%f seconds, "
+                      "%d threads, %d clues undecided)\n",
+                stats.removed, stats.time, threads, stats.undecided);
 
+      if (verbose && unique)
+      {
+        /* Check the generator with a search stopping at the second
+         * solution. */
+        if (!has_unique_solution(grid))
+          errx(EXIT_FAILURE, "error: the generated grid has several "
+                             "solutions");
+        fprintf(file, "Unique solution: checked\n");
+      }
       if (verbose)
       {
+        t_grid work;
+        fprintf(file, "Difficulty: %s\n",
+                difficulty_names[puzzle_difficulty(grid, &work)]);
+
         double time = ((double)(end - start)) / CLOCKS_PER_SEC;
         fprintf(file, "Elapsed time: %f seconds\n", time);
       }
+      free(grid);
     }
   }
 